@@ -26,13 +26,44 @@ action () {
 
 action compute_temp_drude.cpp
 action compute_temp_drude.h
+action fix_dt_reset_drude.cpp
+action fix_dt_reset_drude.h
 action fix_drude_transform.cpp
 action fix_drude_transform.h
+action fix_drude_watchdog.cpp
+action fix_drude_watchdog.h
 action fix_drude.cpp
 action fix_drude.h
+action fix_drude_aspc.cpp
+action fix_drude_aspc.h
+action fix_drude_hardwall.cpp
+action fix_drude_hardwall.h
+action fix_drude_scf.cpp
+action fix_drude_scf.h
 action fix_langevin_drude.cpp
 action fix_langevin_drude.h
+action fix_nh_drude.cpp
+action fix_nh_drude.h
+action fix_npt_drude.cpp
+action fix_npt_drude.h
+action fix_nvt_drude.cpp
+action fix_nvt_drude.h
 action pair_thole.cpp
 action pair_thole.h
 action pair_lj_cut_thole_long.cpp
 action pair_lj_cut_thole_long.h
+action pair_lj_cut_thole_dsf.cpp
+action pair_lj_cut_thole_dsf.h
+action pair_lj_long_thole_long.cpp
+action pair_lj_long_thole_long.h
+action random_philox.h
+action thole_table.cpp
+action thole_table.h
+action fix_langevin_drude_omp.cpp thr_omp.h
+action fix_langevin_drude_omp.h thr_omp.h
+action pair_lj_cut_thole_long_omp.cpp thr_omp.h
+action pair_lj_cut_thole_long_omp.h thr_omp.h
+action pair_lj_cut_thole_dsf_omp.cpp thr_omp.h
+action pair_lj_cut_thole_dsf_omp.h thr_omp.h
+action pair_thole_omp.cpp thr_omp.h
+action pair_thole_omp.h thr_omp.h
@@ -44,7 +44,7 @@ ComputeTempDrude::ComputeTempDrude(LAMMPS *lmp, int narg, char **arg) :
   extlist = new int[6];
   extlist[0] = extlist[1] = 0;
   extlist[2] = extlist[3] = extlist[4] = extlist[5] = 1;
-  tempflag = 0; // because does not compute a single temperature (scalar and vector)
+  tempflag = 1; // scalar is the temperature of the centers of mass with dof
 
   vector = new double[6];
   fix_drude = NULL;
@@ -109,6 +109,7 @@ void ComputeTempDrude::dof_compute()
   MPI_Allreduce(&dof_core_loc,  &dof_core,  1, MPI_LMP_BIGINT, MPI_SUM, world);
   MPI_Allreduce(&dof_drude_loc, &dof_drude, 1, MPI_LMP_BIGINT, MPI_SUM, world);
   dof_core -= fix_dof;
+  dof = dof_core;
   vector[2] = dof_core;
   vector[3] = dof_drude;
 }
@@ -150,7 +151,7 @@ void ComputeTempDrude::compute_vector()
     int *type = atom->type;
     double *rmass = atom->rmass, *mass = atom->mass;
     double **v = atom->v;
-    tagint *drudeid = fix_drude->drudeid;
+    int *drude_local = fix_drude->drude_local;
     int *drudetype = fix_drude->drudetype;
     int dim = domain->dimension;
     double mvv2e = force->mvv2e, kb = force->boltz;
@@ -171,7 +172,7 @@ void ComputeTempDrude::compute_vector()
                 else mcore = mass[type[i]];
                 kineng_core_loc += mcore * ecore;
             } else { // CORE_TYPE
-                int j = atom->map(drudeid[i]);
+                int j = drude_local[i];
                 if (rmass) {
                     mcore = rmass[i];
                     mdrude = rmass[j];
@@ -218,6 +219,7 @@ void ComputeTempDrude::compute_vector()
 }
 
 double ComputeTempDrude::compute_scalar(){
+    invoked_scalar = update->ntimestep;
     compute_vector();
     scalar = vector[0];
     return scalar;
@@ -15,27 +15,29 @@
 #include <stdlib.h>
 #include "fix_drude.h"
 #include "atom.h"
+#include "domain.h"
 #include "comm.h"
 #include "modify.h"
 #include "error.h"
 #include "memory.h"
 #include "molecule.h"
 #include "atom_vec.h"
+#include "force.h"
+#include "bond.h"
+#include "neighbor.h"
 
-#include <set>
 #include <vector>
+#include <algorithm>
 
 using namespace LAMMPS_NS;
 using namespace FixConst;
 
-FixDrude *FixDrude::sptr = NULL;
-
 /* ---------------------------------------------------------------------- */
 
 FixDrude::FixDrude(LAMMPS *lmp, int narg, char **arg) :
   Fix(lmp, narg, arg)
 {
-  if (narg != 3 + atom->ntypes) error->all(FLERR,"Illegal fix drude command");
+  if (narg < 3 + atom->ntypes) error->all(FLERR,"Illegal fix drude command");
 
   comm_border = 1; // drudeid
   special_alter_flag = 1;
@@ -43,7 +45,7 @@ FixDrude::FixDrude(LAMMPS *lmp, int narg, char **arg) :
   is_reduced = false;
 
   memory->create(drudetype, atom->ntypes+1, "fix_drude::drudetype");
-  for (int i=3; i<narg; i++) {
+  for (int i=3; i<3+atom->ntypes; i++) {
       if (arg[i][0] == 'n' || arg[i][0] == 'N' || arg[i][0] == '0')
           drudetype[i-2] = NOPOL_TYPE;
       else if (arg[i][0] == 'c' || arg[i][0] == 'C' || arg[i][0] == '1')
@@ -54,7 +56,23 @@ FixDrude::FixDrude(LAMMPS *lmp, int narg, char **arg) :
           error->all(FLERR, "Illegal fix drude command");
   }
 
+  local_flag = 0;
+  int iarg = 3 + atom->ntypes;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"local") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix drude command");
+      if (strcmp(arg[iarg+1],"no") == 0) local_flag = 0;
+      else if (strcmp(arg[iarg+1],"yes") == 0) local_flag = 1;
+      else error->all(FLERR,"Illegal fix drude command");
+      iarg += 2;
+    } else error->all(FLERR,"Illegal fix drude command");
+  }
+  partners_local = 0;
+
   drudeid = NULL;
+  drude_local = NULL;
+  drude_dq = NULL;
+  drude_disp = NULL;
   grow_arrays(atom->nmax);
   atom->add_callback(0);
   atom->add_callback(1);
@@ -78,6 +96,9 @@ FixDrude::~FixDrude()
   atom->delete_callback(id,0);
   memory->destroy(drudetype);
   memory->destroy(drudeid);
+  memory->destroy(drude_local);
+  memory->destroy(drude_dq);
+  memory->destroy(drude_disp);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -97,139 +118,368 @@ void FixDrude::init()
 int FixDrude::setmask()
 {
   int mask = 0;
+  mask |= PRE_NEIGHBOR;
+  mask |= MIN_PRE_NEIGHBOR;
+  if (local_flag) {
+    mask |= PRE_EXCHANGE;
+    mask |= MIN_PRE_EXCHANGE;
+  }
   return mask;
 }
 
+/* ---------------------------------------------------------------------- */
+
+void FixDrude::setup_pre_exchange()
+{
+  collapse(0);
+}
+
 /* ----------------------------------------------------------------------
-   look in bond lists for Drude partner tags and fill drudeid
+   the positions of the ghost atoms are one step old on a reneighboring
+   step, update them first, the ghost lists are still those of the
+   last borders()
 ------------------------------------------------------------------------- */
-void FixDrude::build_drudeid(){
+
+void FixDrude::pre_exchange()
+{
+  comm->forward_comm();
+  collapse(1);
+}
+
+/* ----------------------------------------------------------------------
+   put each of my Drude particles on top of its core before exchange,
+   so that the pair migrates as a unit, and store the displacement
+   from the core. The displacement is restored in pre_neighbor().
+   The core may be a ghost atom only if ghostflag is set, i.e. if the
+   ghost positions are up to date.
+------------------------------------------------------------------------- */
+
+void FixDrude::collapse(int ghostflag)
+{
   int nlocal = atom->nlocal;
   int *type = atom->type;
+  double **x = atom->x;
 
-  std::vector<tagint> drude_vec; // list of my Drudes' tags
-  std::vector<tagint> core_drude_vec;
-  partner_set = new std::set<tagint>[nlocal]; // Temporary sets of bond partner tags
-
-  sptr = this;
-  if (atom->molecular == 1)
-  {
-    // Build list of my atoms' bond partners
-    for (int i=0; i<nlocal; i++){
-      if (drudetype[type[i]] == NOPOL_TYPE) continue;
-      drudeid[i] = 0;
-      for (int k=0; k<atom->num_bond[i]; k++){
-        core_drude_vec.push_back(atom->tag[i]);
-        core_drude_vec.push_back(atom->bond_atom[i][k]);
-      }
+  for (int i=0; i<nlocal; i++) {
+    drude_disp[i][3] = 0.;
+    if (drudetype[type[i]] != DRUDE_TYPE) continue;
+    int j = atom->map(drudeid[i]);
+    if (j < 0) continue; // no ghosts yet before the first setup
+    j = domain->closest_image(i, j);
+    if (j >= nlocal && !ghostflag) continue;
+    for (int k=0; k<3; k++) {
+      drude_disp[i][k] = x[i][k] - x[j][k];
+      x[i][k] = x[j][k];
     }
+    drude_disp[i][3] = 1.;
   }
-  else
-  {
-    // Template case
-    class Molecule **atommols;
-    atommols = atom->avec->onemols;
-
-    // Build list of my atoms' bond partners
-    for (int i=0; i<nlocal; i++){
-      int imol = atom->molindex[i];
-      int iatom = atom->molatom[i];
-      tagint *batom = atommols[imol]->bond_atom[iatom];
-      tagint tagprev = atom->tag[i] - iatom - 1;
-      int nbonds = atommols[imol]->num_bond[iatom];
-
-      if (drudetype[type[i]] == NOPOL_TYPE) continue;
-      drudeid[i] = 0;
-      for (int k=0; k<nbonds; k++){
-        core_drude_vec.push_back(atom->tag[i]);
-        core_drude_vec.push_back(batom[k]+tagprev);
-      }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrude::min_setup_pre_exchange()
+{
+  setup_pre_exchange();
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrude::min_pre_exchange()
+{
+  pre_exchange();
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrude::setup_pre_neighbor()
+{
+  pre_neighbor();
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrude::min_setup_pre_neighbor()
+{
+  pre_neighbor();
+}
+
+/* ----------------------------------------------------------------------
+   the partner cache is needed after each reneighboring of a minimization
+------------------------------------------------------------------------- */
+
+void FixDrude::min_pre_neighbor()
+{
+  pre_neighbor();
+}
+
+/* ----------------------------------------------------------------------
+   after exchange and borders, cache the local index of the closest image
+   of each atom's Drude partner and the charge of the Drude particle
+   (with the opposite sign for cores), for local and ghost atoms
+------------------------------------------------------------------------- */
+
+void FixDrude::pre_neighbor()
+{
+  int nlocal = atom->nlocal;
+  int nall = atom->nlocal + atom->nghost;
+  int *type = atom->type;
+  double *q = atom->q;
+  double **x = atom->x;
+
+  // put Drude particles back at their displacement from the core
+  // and update the positions of the ghost atoms
+
+  if (local_flag) {
+    for (int i=0; i<nlocal; i++) {
+      if (drudetype[type[i]] != DRUDE_TYPE || drude_disp[i][3] == 0.) continue;
+      int j = atom->map(drudeid[i]);
+      if (j < 0) error->one(FLERR, "Drude partner not found");
+      j = domain->closest_image(i, j);
+      for (int k=0; k<3; k++) x[i][k] = x[j][k] + drude_disp[i][k];
+      drude_disp[i][3] = 0.;
     }
+    comm->forward_comm();
   }
-  // Loop on procs to fill my atoms' sets of bond partners
-  comm->ring(core_drude_vec.size(), sizeof(tagint),
-             (char *) core_drude_vec.data(),
-             4, ring_build_partner, NULL, 1);
-
-  // Build the list of my Drudes' tags
-  // The only bond partners of a Drude particle is its core,
-  // so fill drudeid for my Drudes.
-  for (int i=0; i<nlocal; i++){
-    if (drudetype[type[i]] == DRUDE_TYPE){
-      drude_vec.push_back(atom->tag[i]);
-      drudeid[i] = *partner_set[i].begin(); // only one 1-2 neighbor, the core
+
+  for (int i=0; i<nall; i++) {
+    if (drudetype[type[i]] == NOPOL_TYPE) {
+      drude_local[i] = -1;
+      drude_dq[i] = 0.;
+      continue;
+    }
+    // the charge of a Drude particle does not need its core
+
+    if (drudetype[type[i]] == DRUDE_TYPE) drude_dq[i] = q ? q[i] : 0.;
+    int j = atom->map(drudeid[i]);
+    if (j < 0) { // partner of a ghost atom may be out of range
+      drude_local[i] = -1;
+      if (drudetype[type[i]] == CORE_TYPE) drude_dq[i] = 0.;
+      continue;
     }
+    drude_local[i] = domain->closest_image(i, j);
+    if (drudetype[type[i]] == CORE_TYPE) drude_dq[i] = q ? -q[j] : 0.;
   }
-  // At this point each of my Drudes knows its core.
-  // Send my list of Drudes to other procs and myself
-  // so that each core finds its Drude.
-  comm->ring(drude_vec.size(), sizeof(tagint),
-             (char *) drude_vec.data(),
-             3, ring_search_drudeid, NULL, 1);
-  delete [] partner_set;
+
+  // flag whether the partners of all my atoms are local atoms,
+  // so that fixes can skip the communication of partner data
+
+  int flag = 1;
+  for (int i=0; i<nlocal; i++)
+    if (drudetype[type[i]] != NOPOL_TYPE && drude_local[i] >= nlocal) {
+      flag = 0;
+      break;
+    }
+  MPI_Allreduce(&flag, &partners_local, 1, MPI_INT, MPI_MIN, world);
 }
 
 /* ----------------------------------------------------------------------
- * when receive buffer, build the set of received Drude tags.
- * Look in my cores' bond partner tags if there is a Drude tag.
- * If so fill this core's dureid.
+   look in bond lists for Drude partner tags and fill drudeid
+   using a rendezvous on processors chosen by hashing the atom tags:
+   1) each polarizable atom registers its type and owner on proc hash(tag)
+      and each of its bonds is sent to the procs of both bonded atoms
+   2) the proc of a Drude particle knows its core (only bond partner),
+      tells the owner of the Drude and the proc of the core
+   3) the proc of a core forwards the tag of its Drude to the core owner
+   Each step is a single all-to-all, independent of the number of procs.
 ------------------------------------------------------------------------- */
-void FixDrude::ring_search_drudeid(int size, char *cbuf){
-  // Search for the drude partner of my cores
-  Atom *atom = sptr->atom;
+
+void FixDrude::build_drudeid(){
   int nlocal = atom->nlocal;
   int *type = atom->type;
-  std::set<tagint> *partner_set = sptr->partner_set;
-  tagint *drudeid = sptr->drudeid;
-  int *drudetype = sptr->drudetype;
+  tagint *tag = atom->tag;
+  int me = comm->me;
+  int nprocs = comm->nprocs;
 
-  tagint *first = (tagint *) cbuf;
-  tagint *last = first + size;
-  std::set<tagint> drude_set(first, last);
-  std::set<tagint>::iterator it;
+  double time1 = MPI_Wtime();
 
-  for (int i=0; i<nlocal; i++) {
-    if (drudetype[type[i]] != CORE_TYPE || drudeid[i] > 0) continue;
-    for (it = partner_set[i].begin(); it != partner_set[i].end(); it++) { // Drude-core are 1-2 neighbors
-      if (drude_set.count(*it) > 0){
-        drudeid[i] = *it;
-        break;
-      }
+  std::vector<tagint> sendbuf, recvbuf;
+  std::vector<int> proclist;
+
+  // 1) register polarizable atoms and their bonds
+  // records are (kind, key, value1, value2)
+  // kind = 0: type record, value1 = drudetype, value2 = owner
+  // kind = 1: bond record, value1 = bond partner
+
+  for (int i=0; i<nlocal; i++){
+    drudeid[i] = 0;
+    if (drudetype[type[i]] == NOPOL_TYPE) continue;
+
+    int nbonds;
+    tagint *batom, tagprev = 0;
+    if (atom->molecular == 1) {
+      nbonds = atom->num_bond[i];
+      batom = atom->bond_atom[i];
+    } else { // template case
+      class Molecule **atommols = atom->avec->onemols;
+      int imol = atom->molindex[i];
+      int iatom = atom->molatom[i];
+      nbonds = atommols[imol]->num_bond[iatom];
+      batom = atommols[imol]->bond_atom[iatom];
+      tagprev = tag[i] - iatom - 1;
     }
+
+    sendbuf.push_back(0);
+    sendbuf.push_back(tag[i]);
+    sendbuf.push_back(drudetype[type[i]]);
+    sendbuf.push_back(me);
+    proclist.push_back(tag[i] % nprocs);
+
+    for (int k=0; k<nbonds; k++){
+      tagint partner = batom[k] + tagprev;
+      sendbuf.push_back(1);
+      sendbuf.push_back(tag[i]);
+      sendbuf.push_back(partner);
+      sendbuf.push_back(0);
+      proclist.push_back(tag[i] % nprocs);
+      sendbuf.push_back(1);
+      sendbuf.push_back(partner);
+      sendbuf.push_back(tag[i]);
+      sendbuf.push_back(0);
+      proclist.push_back(partner % nprocs);
+    }
+  }
+  rendezvous_exchange(sendbuf, proclist, 4, recvbuf);
+
+  // sorted flat tables of (tag, drudetype, owner) and (tag, bond partner)
+
+  std::vector<tagint> typeinfo;
+  std::vector<std::pair<tagint,tagint> > bonds;
+  for (size_t n=0; n<recvbuf.size(); n+=4) {
+    if (recvbuf[n] == 0) {
+      typeinfo.push_back(recvbuf[n+1]);
+      typeinfo.push_back(recvbuf[n+2]);
+      typeinfo.push_back(recvbuf[n+3]);
+    } else bonds.push_back(std::make_pair(recvbuf[n+1], recvbuf[n+2]));
+  }
+  std::vector<tagint> typekeys(typeinfo.size()/3);
+  std::vector<int> typeorder(typekeys.size());
+  for (size_t n=0; n<typekeys.size(); n++) typekeys[n] = typeinfo[3*n];
+  std::sort(typekeys.begin(), typekeys.end());
+  for (size_t n=0; n<typekeys.size(); n++) {
+    size_t k = std::lower_bound(typekeys.begin(), typekeys.end(),
+                                typeinfo[3*n]) - typekeys.begin();
+    typeorder[k] = n;
+  }
+  std::sort(bonds.begin(), bonds.end());
+
+  // 2) each Drude particle has only one 1-2 neighbor, its core
+  // records are (kind, key, value)
+  // kind = 0: for the owner of the Drude key, value = core tag
+  // kind = 1: for the proc of the core key, value = Drude tag
+
+  sendbuf.clear();
+  proclist.clear();
+  for (size_t n=0; n<typeinfo.size(); n+=3) {
+    if (typeinfo[n+1] != DRUDE_TYPE) continue;
+    tagint drude_tag = typeinfo[n];
+    std::vector<std::pair<tagint,tagint> >::iterator it =
+      std::lower_bound(bonds.begin(), bonds.end(),
+                       std::make_pair(drude_tag, (tagint) 0));
+    if (it == bonds.end() || it->first != drude_tag)
+      error->one(FLERR, "Drude particle has no bond to its core");
+    tagint core_tag = it->second;
+    sendbuf.push_back(0);
+    sendbuf.push_back(drude_tag);
+    sendbuf.push_back(core_tag);
+    proclist.push_back((int) typeinfo[n+2]);
+    sendbuf.push_back(1);
+    sendbuf.push_back(core_tag);
+    sendbuf.push_back(drude_tag);
+    proclist.push_back(core_tag % nprocs);
+  }
+  rendezvous_exchange(sendbuf, proclist, 3, recvbuf);
+
+  // now each of my Drudes knows its core
+  // keep the smallest Drude tag for each core
+
+  std::vector<std::pair<tagint,tagint> > core_drude;
+  for (size_t n=0; n<recvbuf.size(); n+=3) {
+    if (recvbuf[n] == 0) {
+      int i = atom->map(recvbuf[n+1]);
+      if (i >= 0 && i < nlocal) drudeid[i] = recvbuf[n+2];
+    } else core_drude.push_back(std::make_pair(recvbuf[n+1], recvbuf[n+2]));
+  }
+  std::sort(core_drude.begin(), core_drude.end());
+
+  // 3) send each core's Drude tag to the owner of the core
+
+  sendbuf.clear();
+  proclist.clear();
+  for (size_t n=0; n<core_drude.size(); n++) {
+    tagint core_tag = core_drude[n].first;
+    if (n > 0 && core_drude[n-1].first == core_tag) continue;
+    std::vector<tagint>::iterator it =
+      std::lower_bound(typekeys.begin(), typekeys.end(), core_tag);
+    if (it == typekeys.end() || *it != core_tag) continue;
+    int k = typeorder[it - typekeys.begin()];
+    if (typeinfo[3*k+1] != CORE_TYPE) continue;
+    sendbuf.push_back(core_tag);
+    sendbuf.push_back(core_drude[n].second);
+    proclist.push_back((int) typeinfo[3*k+2]);
+  }
+  rendezvous_exchange(sendbuf, proclist, 2, recvbuf);
+
+  for (size_t n=0; n<recvbuf.size(); n+=2) {
+    int i = atom->map(recvbuf[n]);
+    if (i >= 0 && i < nlocal) drudeid[i] = recvbuf[n+1];
+  }
+
+  double time_loc = MPI_Wtime() - time1, time_all;
+  MPI_Allreduce(&time_loc, &time_all, 1, MPI_DOUBLE, MPI_MAX, world);
+  if (me == 0) {
+    if (screen) fprintf(screen, "Drude partners found in %g seconds on %d procs\n", time_all, nprocs);
+    if (logfile) fprintf(logfile, "Drude partners found in %g seconds on %d procs\n", time_all, nprocs);
   }
 }
 
 /* ----------------------------------------------------------------------
- * buffer contains bond partners. Look for my atoms and add their partner's
- * tag in its set of bond partners.
+ * send records of nw tags each to the procs in proclist with a single
+ * all-to-all and return the records received by this proc in recvbuf
 ------------------------------------------------------------------------- */
-void FixDrude::ring_build_partner(int size, char *cbuf){
-  // Add partners from incoming list
-  Atom *atom = sptr->atom;
-  int nlocal = atom->nlocal;
-  std::set<tagint> *partner_set = sptr->partner_set;
-  tagint *it = (tagint *) cbuf;
-  tagint *last = it + size;
-
-  while (it < last) {
-    int j = atom->map(*it);
-    if (j >= 0 && j < nlocal)
-      partner_set[j].insert(*(it+1));
-    j = atom->map(*(it+1));
-    if (j >= 0 && j < nlocal)
-      partner_set[j].insert(*it);
-    it += 2;
+void FixDrude::rendezvous_exchange(std::vector<tagint> &sendbuf,
+                                   std::vector<int> &proclist, int nw,
+                                   std::vector<tagint> &recvbuf){
+  int nprocs = comm->nprocs;
+  int nrecords = proclist.size();
+  std::vector<int> sendcounts(nprocs, 0), senddispls(nprocs, 0);
+  std::vector<int> recvcounts(nprocs, 0), recvdispls(nprocs, 0);
+
+  for (int n=0; n<nrecords; n++) sendcounts[proclist[n]] += nw;
+  for (int p=1; p<nprocs; p++)
+    senddispls[p] = senddispls[p-1] + sendcounts[p-1];
+
+  // sort records by destination proc
+
+  std::vector<tagint> sorted(sendbuf.size());
+  std::vector<int> offset(senddispls);
+  for (int n=0; n<nrecords; n++) {
+    int m = offset[proclist[n]];
+    for (int k=0; k<nw; k++) sorted[m+k] = sendbuf[n*nw+k];
+    offset[proclist[n]] += nw;
   }
+
+  MPI_Alltoall(sendcounts.data(), 1, MPI_INT,
+               recvcounts.data(), 1, MPI_INT, world);
+  for (int p=1; p<nprocs; p++)
+    recvdispls[p] = recvdispls[p-1] + recvcounts[p-1];
+  recvbuf.resize(recvdispls[nprocs-1] + recvcounts[nprocs-1]);
+
+  MPI_Alltoallv(sorted.data(), sendcounts.data(), senddispls.data(),
+                MPI_LMP_TAGINT, recvbuf.data(), recvcounts.data(),
+                recvdispls.data(), MPI_LMP_TAGINT, world);
 }
 
 
 /* ----------------------------------------------------------------------
-   allocate atom-based array for drudeid
+   allocate atom-based arrays for drudeid and cached partner info
 ------------------------------------------------------------------------- */
 
 void FixDrude::grow_arrays(int nmax)
 {
   memory->grow(drudeid,nmax,"fix_drude:drudeid");
+  memory->grow(drude_local,nmax,"fix_drude:drude_local");
+  memory->grow(drude_dq,nmax,"fix_drude:drude_dq");
+  memory->grow(drude_disp,nmax,4,"fix_drude:drude_disp");
 }
 
 /* ----------------------------------------------------------------------
@@ -239,6 +489,7 @@ void FixDrude::grow_arrays(int nmax)
 void FixDrude::copy_arrays(int i, int j, int delflag)
 {
     drudeid[j] = drudeid[i];
+    for (int k=0; k<4; k++) drude_disp[j][k] = drude_disp[i][k];
 }
 
 /* ----------------------------------------------------------------------
@@ -249,6 +500,8 @@ int FixDrude::pack_exchange(int i, double *buf)
 {
     int m = 0;
     buf[m++] = ubuf(drudeid[i]).d;
+    if (local_flag)
+      for (int k=0; k<4; k++) buf[m++] = drude_disp[i][k];
     return m;
 }
 
@@ -260,6 +513,8 @@ int FixDrude::unpack_exchange(int nlocal, double *buf)
 {
     int m = 0;
     drudeid[nlocal] = (tagint) ubuf(buf[m++]).i;
+    if (local_flag)
+      for (int k=0; k<4; k++) drude_disp[nlocal][k] = buf[m++];
     return m;
 }
 
@@ -290,9 +545,54 @@ int FixDrude::unpack_border(int n, int first, double *buf)
     return m;
 }
 
+/* ----------------------------------------------------------------------
+   stiffness 2K of the harmonic core-Drude bonds, per Drude type
+   E = K (r-r0)^2 with r0 = 0, so the bond force at r = 1 is -2K
+   types without a core-Drude bond get 0, the bond list must be built
+------------------------------------------------------------------------- */
+
+void FixDrude::bond_stiffness(double *k_drude)
+{
+  int ntypes = atom->ntypes;
+  int *type = atom->type;
+  int **bondlist = neighbor->bondlist;
+  int nbondlist = neighbor->nbondlist;
+
+  double *kloc = new double[ntypes+1];
+  for (int itype = 0; itype <= ntypes; itype++) kloc[itype] = 0.0;
+
+  if (force->bond) {
+    for (int n = 0; n < nbondlist; n++) {
+      int i1 = bondlist[n][0];
+      int i2 = bondlist[n][1];
+      int btype = bondlist[n][2];
+      if (btype <= 0) continue;
+      int idrude;
+      if (drudetype[type[i1]] == DRUDE_TYPE &&
+          drudetype[type[i2]] == CORE_TYPE) idrude = i1;
+      else if (drudetype[type[i2]] == DRUDE_TYPE &&
+               drudetype[type[i1]] == CORE_TYPE) idrude = i2;
+      else continue;
+      double fbond;
+      force->bond->single(btype, 1.0, i1, i2, fbond);
+      if (-fbond > kloc[type[idrude]]) kloc[type[idrude]] = -fbond;
+    }
+  }
+
+  MPI_Allreduce(kloc, k_drude, ntypes+1, MPI_DOUBLE, MPI_MAX, world);
+  delete [] kloc;
+}
+
 /* ----------------------------------------------------------------------
    Rebuild the list of special neighbors if atom_style is Drude
    so that each Drude particle is equivalent to its core atom.
+   The Drude status of the tags in my special lists is looked up
+   with a rendezvous on procs chosen by hashing the tags:
+   1) Drudes and cores register on proc hash(tag), and I query the
+      status of the tags in my special lists in the same exchange
+   2) replies to queries, and owner of each Drude sent to its core owner
+   3) cores send their new special list to the owner of their Drude
+   Each special list is rewritten in a single merge pass.
 ------------------------------------------------------------------------- */
 
 void FixDrude::rebuild_special(){
@@ -302,15 +602,15 @@ void FixDrude::rebuild_special(){
   int **nspecial = atom->nspecial;
   tagint **special = atom->special;
   int *type = atom->type;
+  tagint *tag = atom->tag;
+  int me = comm->me;
+  int nprocs = comm->nprocs;
 
   if (atom->molecular != 1)
     return;
 
-  // Make sure that drude partners know each other
-  //build_drudeid();
-
   // Log info
-  if (comm->me == 0) {
+  if (me == 0) {
     if (screen) fprintf(screen, "Rebuild special list taking Drude particles into account\n");
     if (logfile) fprintf(logfile, "Rebuild special list taking Drude particles into account\n");
   }
@@ -320,196 +620,183 @@ void FixDrude::rebuild_special(){
     if (nspecmax_loc < nspecial[i][2]) nspecmax_loc = nspecial[i][2];
   }
   MPI_Allreduce(&nspecmax_loc, &nspecmax_old, 1, MPI_INT, MPI_MAX, world);
-  if (comm->me == 0) {
+  if (me == 0) {
     if (screen) fprintf(screen, "Old max number of 1-2 to 1-4 neighbors: %d\n", nspecmax_old);
     if (logfile) fprintf(logfile, "Old max number of 1-2 to 1-4 neighbors: %d\n", nspecmax_old);
   }
 
-  // Build lists of drude and core-drude pairs
-  std::vector<tagint> drude_vec, core_drude_vec, core_special_vec;
+  std::vector<tagint> sendbuf, recvbuf;
+  std::vector<int> proclist;
+
+  // 1) registration of polarizable atoms and queries
+  // records are (kind, key, value1, value2)
+  // kind = 0: Drude, value1 = owner
+  // kind = 1: core, value1 = Drude tag
+  // kind = 2: core of the Drude key, value1 = core owner, value2 = core tag
+  // kind = 3: query for the status of key, value1 = proc asking
+
   for (int i=0; i<nlocal; i++) {
     if (drudetype[type[i]] == DRUDE_TYPE) {
-      drude_vec.push_back(atom->tag[i]);
-    } else if (drudetype[type[i]] == CORE_TYPE){
-      core_drude_vec.push_back(atom->tag[i]);
-      core_drude_vec.push_back(drudeid[i]);
+      sendbuf.push_back(0);
+      sendbuf.push_back(tag[i]);
+      sendbuf.push_back(me);
+      sendbuf.push_back(0);
+      proclist.push_back(tag[i] % nprocs);
+    } else if (drudetype[type[i]] == CORE_TYPE && drudeid[i] > 0) {
+      sendbuf.push_back(1);
+      sendbuf.push_back(tag[i]);
+      sendbuf.push_back(drudeid[i]);
+      sendbuf.push_back(0);
+      proclist.push_back(tag[i] % nprocs);
+      sendbuf.push_back(2);
+      sendbuf.push_back(drudeid[i]);
+      sendbuf.push_back(me);
+      sendbuf.push_back(tag[i]);
+      proclist.push_back(drudeid[i] % nprocs);
     }
   }
-  // Remove Drude particles from the special lists of each proc
-  comm->ring(drude_vec.size(), sizeof(tagint),
-             (char *) drude_vec.data(),
-             9, ring_remove_drude, NULL, 1);
-  // Add back Drude particles in the lists just after their core
-  comm->ring(core_drude_vec.size(), sizeof(tagint),
-             (char *) core_drude_vec.data(),
-             10, ring_add_drude, NULL, 1);
 
-  // Check size of special list
-  nspecmax_loc = 0;
+  std::vector<tagint> query;
   for (int i=0; i<nlocal; i++) {
-    if (nspecmax_loc < nspecial[i][2]) nspecmax_loc = nspecial[i][2];
+    if (drudetype[type[i]] == DRUDE_TYPE) continue;
+    for (int k=0; k<nspecial[i][2]; k++) query.push_back(special[i][k]);
   }
-  MPI_Allreduce(&nspecmax_loc, &nspecmax, 1, MPI_INT, MPI_MAX, world);
-  if (comm->me == 0) {
-    if (screen) fprintf(screen, "New max number of 1-2 to 1-4 neighbors: %d (+%d)\n", nspecmax, nspecmax - nspecmax_old);
-    if (logfile) fprintf(logfile, "New max number of 1-2 to 1-4 neighbors: %d (+%d)\n", nspecmax, nspecmax - nspecmax_old);
+  std::sort(query.begin(), query.end());
+  query.erase(std::unique(query.begin(), query.end()), query.end());
+  for (size_t n=0; n<query.size(); n++) {
+    sendbuf.push_back(3);
+    sendbuf.push_back(query[n]);
+    sendbuf.push_back(me);
+    sendbuf.push_back(0);
+    proclist.push_back(query[n] % nprocs);
   }
-  if (atom->maxspecial < nspecmax) {
-    char str[1024];
-    sprintf(str, "Not enough space in special: special_bonds extra should be at least %d", nspecmax - nspecmax_old);
-    error->all(FLERR, str);
+  rendezvous_exchange(sendbuf, proclist, 4, recvbuf);
+
+  // status of a tag is -1 for a Drude, its Drude tag for a core
+
+  std::vector<std::pair<tagint,tagint> > status;
+  std::vector<std::pair<tagint,int> > drude_owner;
+  for (size_t n=0; n<recvbuf.size(); n+=4) {
+    if (recvbuf[n] == 0) {
+      status.push_back(std::make_pair(recvbuf[n+1], (tagint) -1));
+      drude_owner.push_back(std::make_pair(recvbuf[n+1], (int) recvbuf[n+2]));
+    } else if (recvbuf[n] == 1)
+      status.push_back(std::make_pair(recvbuf[n+1], recvbuf[n+2]));
   }
+  std::sort(status.begin(), status.end());
+  std::sort(drude_owner.begin(), drude_owner.end());
+
+  // 2) replies to the queries and Drude owners to the core owners
+  // records are (kind, key, value)
+  // kind = 0: status of key
+  // kind = 1: owner of the Drude of core key
+
+  sendbuf.clear();
+  proclist.clear();
+  for (size_t n=0; n<recvbuf.size(); n+=4) {
+    if (recvbuf[n] == 3) {
+      std::vector<std::pair<tagint,tagint> >::iterator it =
+        std::lower_bound(status.begin(), status.end(),
+                         std::make_pair(recvbuf[n+1], (tagint) -1));
+      if (it == status.end() || it->first != recvbuf[n+1]) continue;
+      sendbuf.push_back(0);
+      sendbuf.push_back(it->first);
+      sendbuf.push_back(it->second);
+      proclist.push_back((int) recvbuf[n+2]);
+    } else if (recvbuf[n] == 2) {
+      std::vector<std::pair<tagint,int> >::iterator it =
+        std::lower_bound(drude_owner.begin(), drude_owner.end(),
+                         std::make_pair(recvbuf[n+1], 0));
+      if (it == drude_owner.end() || it->first != recvbuf[n+1]) continue;
+      sendbuf.push_back(1);
+      sendbuf.push_back(recvbuf[n+3]);
+      sendbuf.push_back(it->second);
+      proclist.push_back((int) recvbuf[n+2]);
+    }
+  }
+  rendezvous_exchange(sendbuf, proclist, 3, recvbuf);
 
-  // Build list of cores' special lists to communicate to ghost drude particles
-  for (int i=0; i<nlocal; i++) {
-    if (drudetype[type[i]] != CORE_TYPE) continue;
-    core_special_vec.push_back(atom->tag[i]);
-    core_special_vec.push_back((tagint) nspecial[i][0]);
-    core_special_vec.push_back((tagint) nspecial[i][1]);
-    core_special_vec.push_back((tagint) nspecial[i][2]);
-    for (int j=1; j<nspecial[i][2]; j++)
-      core_special_vec.push_back(special[i][j]);
+  status.clear();
+  drude_owner.clear();
+  for (size_t n=0; n<recvbuf.size(); n+=3) {
+    if (recvbuf[n] == 0) status.push_back(std::make_pair(recvbuf[n+1], recvbuf[n+2]));
+    else drude_owner.push_back(std::make_pair(recvbuf[n+1], (int) recvbuf[n+2]));
   }
-  // Copy core's list into their drude list
-  comm->ring(core_special_vec.size(), sizeof(tagint),
-             (char *) core_special_vec.data(),
-             11, ring_copy_drude, NULL, 1);
-}
+  std::sort(status.begin(), status.end());
 
-/* ----------------------------------------------------------------------
- * When receive buffer, build a set of drude tags, look into my atoms'
- * special list if some tags are drude particles. If so, remove it.
-------------------------------------------------------------------------- */
-void FixDrude::ring_remove_drude(int size, char *cbuf){
-  // Remove all drude particles from special list
-  Atom *atom = sptr->atom;
-  int nlocal = atom->nlocal;
-  int **nspecial = atom->nspecial;
-  tagint **special = atom->special;
-  int *type = atom->type;
-  tagint *first = (tagint *) cbuf;
-  tagint *last = first + size;
-  std::set<tagint> drude_set(first, last);
-  int *drudetype = sptr->drudetype;
+  // Merge pass on the special list of my cores and non-polarizable atoms:
+  // remove Drude particles, add my own Drude first if I am a core,
+  // and add the Drude of each core just after it
 
+  std::vector<tagint> merged;
+  nspecmax_loc = 0;
   for (int i=0; i<nlocal; i++) {
     if (drudetype[type[i]] == DRUDE_TYPE) continue;
-    for (int j=0; j<nspecial[i][2]; j++) {
-      if (drude_set.count(special[i][j]) > 0) { // I identify a drude in my special list, remove it
-        // left shift
-        nspecial[i][2]--;
-        for (int k=j; k<nspecial[i][2]; k++)
-          special[i][k] = special[i][k+1];
-        if (j < nspecial[i][1]) {
-          nspecial[i][1]--;
-          if (j < nspecial[i][0]) nspecial[i][0]--;
-        }
-        j--;
+    merged.clear();
+    if (drudetype[type[i]] == CORE_TYPE && drudeid[i] > 0)
+      merged.push_back(drudeid[i]);
+    int newspecial[3];
+    int k = 0;
+    for (int s=0; s<3; s++) {
+      for (; k<nspecial[i][s]; k++) {
+        tagint t = special[i][k];
+        std::vector<std::pair<tagint,tagint> >::iterator it =
+          std::lower_bound(status.begin(), status.end(),
+                           std::make_pair(t, (tagint) -1));
+        if (it != status.end() && it->first == t) {
+          if (it->second < 0) continue; // a Drude, remove it
+          merged.push_back(t);
+          merged.push_back(it->second); // a core, add its Drude
+        } else merged.push_back(t);
       }
+      newspecial[s] = merged.size();
     }
+    if (nspecmax_loc < newspecial[2]) nspecmax_loc = newspecial[2];
+    if (newspecial[2] > atom->maxspecial) continue;
+    for (int s=0; s<3; s++) nspecial[i][s] = newspecial[s];
+    for (k=0; k<newspecial[2]; k++) special[i][k] = merged[k];
   }
-}
 
-/* ----------------------------------------------------------------------
- * When receive buffer, build a map core tag -> drude tag.
- * Loop on my atoms' special list to find core tags. Insert their Drude
- * particle if they have one.
-------------------------------------------------------------------------- */
-void FixDrude::ring_add_drude(int size, char *cbuf){
-  // Assume special array size is big enough
-  // Add all particle just after their core in the special list
-  Atom *atom = sptr->atom;
-  int nlocal = atom->nlocal;
-  int **nspecial = atom->nspecial;
-  tagint **special = atom->special;
-  int *type = atom->type;
-  tagint *drudeid = sptr->drudeid;
-  int *drudetype = sptr->drudetype;
-
-  tagint *first = (tagint *) cbuf;
-  tagint *last = first + size;
-  std::map<tagint, tagint> core_drude_map;
-
-  tagint *it = first;
-  while (it < last) {
-    tagint core_tag = *it;
-    it++;
-    core_drude_map[core_tag] = *it;
-    it++;
+  // Check size of special list
+  MPI_Allreduce(&nspecmax_loc, &nspecmax, 1, MPI_INT, MPI_MAX, world);
+  if (me == 0) {
+    if (screen) fprintf(screen, "New max number of 1-2 to 1-4 neighbors: %d (+%d)\n", nspecmax, nspecmax - nspecmax_old);
+    if (logfile) fprintf(logfile, "New max number of 1-2 to 1-4 neighbors: %d (+%d)\n", nspecmax, nspecmax - nspecmax_old);
   }
-
-  for (int i=0; i<nlocal; i++) {
-    if (drudetype[type[i]] == DRUDE_TYPE) continue;
-    if (core_drude_map.count(atom->tag[i]) > 0) { // I identify myself as a core, add my own drude
-      // right shift
-      for (int k=nspecial[i][2]-1; k>=0; k--)
-        special[i][k+1] = special[i][k];
-      special[i][0] = drudeid[i];
-      nspecial[i][0]++;
-      nspecial[i][1]++;
-      nspecial[i][2]++;
-    }
-    for (int j=0; j<nspecial[i][2]; j++) {
-      if (core_drude_map.count(special[i][j]) > 0) { // I identify a core in my special list, add his drude
-        // right shift
-        for (int k=nspecial[i][2]-1; k>j; k--)
-          special[i][k+1] = special[i][k];
-        special[i][j+1] = core_drude_map[special[i][j]];
-        nspecial[i][2]++;
-        if (j < nspecial[i][1]) {
-          nspecial[i][1]++;
-          if (j < nspecial[i][0]) nspecial[i][0]++;
-        }
-        j++;
-      }
-    }
+  if (atom->maxspecial < nspecmax) {
+    char str[1024];
+    sprintf(str, "Not enough space in special: special_bonds extra should be at least %d", nspecmax - nspecmax_old);
+    error->all(FLERR, str);
   }
-}
 
-/* ----------------------------------------------------------------------
- * When receive buffer, build a map core tag -> pointer to special info
- * in the buffer. Loop on my Drude particles and copy their special
- * info from that of their core if the latter is found in the map.
-------------------------------------------------------------------------- */
-void FixDrude::ring_copy_drude(int size, char *cbuf){
-  // Copy special list of drude from its core (except itself)
-  Atom *atom = sptr->atom;
-  int nlocal = atom->nlocal;
-  int **nspecial = atom->nspecial;
-  tagint **special = atom->special;
-  int *type = atom->type;
-  tagint *drudeid = sptr->drudeid;
-  int *drudetype = sptr->drudetype;
-
-  tagint *first = (tagint *) cbuf;
-  tagint *last = first + size;
-  std::map<tagint, tagint*> core_special_map;
-
-  tagint *it = first;
-  while (it < last) {
-    tagint core_tag = *it;
-    it++;
-    core_special_map[core_tag] = it;
-    it += 2;
-    it += (int) *it;
-  }
+  // 3) copy the special list of each core into that of its Drude,
+  // replacing the Drude itself by its core
+  // records are (Drude tag, nspecial[3], special list padded to maxspecial)
 
+  int nw = 4 + atom->maxspecial;
+  std::sort(drude_owner.begin(), drude_owner.end());
+  sendbuf.clear();
+  proclist.clear();
   for (int i=0; i<nlocal; i++) {
-    if (drudetype[type[i]] != DRUDE_TYPE) continue;
-    if (core_special_map.count(drudeid[i]) > 0) { // My core is in this list, copy its special info
-      it = core_special_map[drudeid[i]];
-      nspecial[i][0] = (int) *it;
-      it++;
-      nspecial[i][1] = (int) *it;
-      it++;
-      nspecial[i][2] = (int) *it;
-      it++;
-      special[i][0] = drudeid[i];
-      for (int k=1; k<nspecial[i][2]; k++) {
-        special[i][k] = *it;
-        it++;
-      }
-    }
+    if (drudetype[type[i]] != CORE_TYPE || drudeid[i] <= 0) continue;
+    std::vector<std::pair<tagint,int> >::iterator it =
+      std::lower_bound(drude_owner.begin(), drude_owner.end(),
+                       std::make_pair(tag[i], 0));
+    if (it == drude_owner.end() || it->first != tag[i]) continue;
+    sendbuf.push_back(drudeid[i]);
+    for (int s=0; s<3; s++) sendbuf.push_back(nspecial[i][s]);
+    sendbuf.push_back(tag[i]);
+    for (int k=1; k<nspecial[i][2]; k++) sendbuf.push_back(special[i][k]);
+    for (int k=nspecial[i][2]; k<atom->maxspecial; k++) sendbuf.push_back(0);
+    proclist.push_back(it->second);
+  }
+  rendezvous_exchange(sendbuf, proclist, nw, recvbuf);
+
+  for (size_t n=0; n<recvbuf.size(); n+=nw) {
+    int i = atom->map(recvbuf[n]);
+    if (i < 0 || i >= nlocal) continue;
+    for (int s=0; s<3; s++) nspecial[i][s] = (int) recvbuf[n+1+s];
+    for (int k=0; k<nspecial[i][2]; k++) special[i][k] = recvbuf[n+4+k];
   }
 }
 
@@ -518,6 +805,7 @@ void FixDrude::ring_copy_drude(int size, char *cbuf){
  * special list must be up-to-date
  * ----------------------------------------------------------------------*/
 void FixDrude::set_arrays(int i){
+    drude_disp[i][3] = 0.;
     if (drudetype[atom->type[i]] != NOPOL_TYPE){
         if (atom->nspecial[i] ==0) error->all(FLERR, "Polarizable atoms cannot be inserted with special lists info from the molecule template");
         drudeid[i] = atom->special[i][0]; // Drude partner should be at first place in the special list
@@ -21,7 +21,7 @@ FixStyle(drude,FixDrude)
 #define LMP_FIX_DRUDE_H
 
 #include "fix.h"
-#include <set>
+#include <vector>
 
 #define NOPOL_TYPE 0
 #define CORE_TYPE  1
@@ -33,12 +33,23 @@ class FixDrude : public Fix {
  public:
   int * drudetype;
   tagint * drudeid;
+  int * drude_local;     // local index of closest image of Drude partner
+  double * drude_dq;     // charge of the Drude particle, with sign of atom
+  int partners_local;    // 1 if all partners of local atoms are local
   bool is_reduced;
 
   FixDrude(class LAMMPS *, int, char **);
   virtual ~FixDrude();
   int setmask();
   void init();
+  void setup_pre_exchange();
+  void pre_exchange();
+  void min_setup_pre_exchange();
+  void min_pre_exchange();
+  void setup_pre_neighbor();
+  void pre_neighbor();
+  void min_setup_pre_neighbor();
+  void min_pre_neighbor();
 
   void grow_arrays(int nmax);
   void copy_arrays(int i, int j, int delflag);
@@ -48,18 +59,18 @@ class FixDrude : public Fix {
   int pack_border(int n, int *list, double *buf);
   int unpack_border(int n, int first, double *buf);
 
+  void bond_stiffness(double *);
+
 private:
   int rebuildflag;
-  static FixDrude *sptr;
-  std::set<tagint> * partner_set;
+  int local_flag;        // 1 if cores and Drudes migrate together
+  double ** drude_disp;  // Drude displacement from core during exchange
 
+  void collapse(int);
   void build_drudeid();
-  static void ring_search_drudeid(int size, char *cbuf);
-  static void ring_build_partner(int size, char *cbuf);
+  void rendezvous_exchange(std::vector<tagint> &, std::vector<int> &, int,
+                           std::vector<tagint> &);
   void rebuild_special();
-  static void ring_remove_drude(int size, char *cbuf);
-  static void ring_add_drude(int size, char *cbuf);
-  static void ring_copy_drude(int size, char *cbuf);
 };
 
 }
@@ -0,0 +1,264 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <string.h>
+#include "fix_drude_aspc.h"
+#include "atom.h"
+#include "force.h"
+#include "comm.h"
+#include "modify.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+/* ----------------------------------------------------------------------
+   binomial coefficient
+------------------------------------------------------------------------- */
+
+static double binomial(int n, int p)
+{
+  if (p < 0 || p > n) return 0.0;
+  double c = 1.0;
+  for (int i = 1; i <= p; i++) c = c * (n - p + i) / i;
+  return c;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixDrudeASPC::FixDrudeASPC(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg)
+{
+  if (narg < 4) error->all(FLERR,"Illegal fix drude/aspc command");
+
+  korder = force->inumeric(FLERR,arg[3]);
+  if (korder < 0) error->all(FLERR,"Illegal fix drude/aspc command");
+
+  corrector = 0;
+  int iarg = 4;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"corrector") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix drude/aspc command");
+      if (strcmp(arg[iarg+1],"no") == 0) corrector = 0;
+      else if (strcmp(arg[iarg+1],"yes") == 0) corrector = 1;
+      else error->all(FLERR,"Illegal fix drude/aspc command");
+      iarg += 2;
+    } else error->all(FLERR,"Illegal fix drude/aspc command");
+  }
+
+  // predictor coefficients of Kolafa for all orders up to k
+  // B_j = (-1)^(j+1) j C(2p+4,p+2-j) / C(2p+2,p+1), j = 1..p+2
+
+  nstore = korder + 2;
+  memory->create(coeff,korder+1,nstore,"drude/aspc:coeff");
+  for (int p = 0; p <= korder; p++)
+    for (int j = 1; j <= nstore; j++) {
+      double b = j * binomial(2*p+4,p+2-j) / binomial(2*p+2,p+1);
+      coeff[p][j-1] = (j % 2) ? b : -b;
+    }
+
+  nhist = 0;
+  iorder = -1;
+  k_drude = NULL;
+  fix_drude = NULL;
+
+  hist = NULL;
+  grow_arrays(atom->nmax);
+  atom->add_callback(0);
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixDrudeASPC::~FixDrudeASPC()
+{
+  atom->delete_callback(id,0);
+  memory->destroy(hist);
+  memory->destroy(coeff);
+  delete [] k_drude;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixDrudeASPC::setmask()
+{
+  int mask = 0;
+  mask |= PRE_FORCE;
+  mask |= POST_FORCE;
+  return mask;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrudeASPC::init()
+{
+  int ifix;
+  for (ifix = 0; ifix < modify->nfix; ifix++)
+    if (strcmp(modify->fix[ifix]->style,"drude") == 0) break;
+  if (ifix == modify->nfix) error->all(FLERR,"Fix drude/aspc requires fix drude");
+  fix_drude = (FixDrude *) modify->fix[ifix];
+}
+
+/* ----------------------------------------------------------------------
+   the history restarts from the displacements at the start of each run
+------------------------------------------------------------------------- */
+
+void FixDrudeASPC::setup(int vflag)
+{
+  if (corrector) {
+    int *type = atom->type;
+    int *mask = atom->mask;
+    int nlocal = atom->nlocal;
+    int *drudetype = fix_drude->drudetype;
+
+    if (!k_drude) k_drude = new double[atom->ntypes+1];
+    fix_drude->bond_stiffness(k_drude);
+
+    int flag = 0, flag_all;
+    for (int i = 0; i < nlocal; i++)
+      if (mask[i] & groupbit && drudetype[type[i]] == DRUDE_TYPE &&
+          k_drude[type[i]] <= 0.0) flag = 1;
+    MPI_Allreduce(&flag, &flag_all, 1, MPI_INT, MPI_MAX, world);
+    if (flag_all)
+      error->all(FLERR,"Fix drude/aspc corrector requires a bond between "
+                 "each core and its Drude");
+  }
+
+  nhist = 0;
+  iorder = -1;
+  record(0);
+}
+
+/* ----------------------------------------------------------------------
+   predict the Drude displacements from their history
+   with fewer than k+2 stored steps the order is lowered
+------------------------------------------------------------------------- */
+
+void FixDrudeASPC::pre_force(int vflag)
+{
+  if (nhist == 0) return;
+
+  double **x = atom->x;
+  int *mask = atom->mask;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+
+  iorder = nhist - 2;
+  if (iorder > korder) iorder = korder;
+  int n = (iorder < 0) ? 1 : iorder + 2;
+
+  for (int i = 0; i < nlocal; i++) {
+    if (!(mask[i] & groupbit) || drudetype[type[i]] != DRUDE_TYPE) continue;
+    int icore = drude_local[i];
+    for (int k = 0; k < 3; k++) {
+      double d = hist[i][k];
+      if (iorder >= 0) {
+        d = 0.0;
+        for (int j = 0; j < n; j++) d += coeff[iorder][j] * hist[i][3*j+k];
+      }
+      x[i][k] = x[icore][k] + d;
+    }
+  }
+
+  // ghost Drudes must be at the predicted positions for the forces
+
+  comm->forward_comm();
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrudeASPC::post_force(int vflag)
+{
+  record(corrector);
+}
+
+/* ----------------------------------------------------------------------
+   push the current displacements into the history
+   the corrector mixes the prediction with one SCF step preconditioned
+   by the bond stiffness, d + omega f/k, with omega = (k+2)/(2k+3)
+   the forces of the step are those at the predicted positions
+------------------------------------------------------------------------- */
+
+void FixDrudeASPC::record(int correct)
+{
+  double **x = atom->x, **f = atom->f;
+  int *mask = atom->mask;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+
+  int p = (iorder < 0) ? 0 : iorder;
+  double omega = (p + 2.0) / (2.0*p + 3.0);
+
+  for (int i = 0; i < nlocal; i++) {
+    if (!(mask[i] & groupbit) || drudetype[type[i]] != DRUDE_TYPE) continue;
+    int icore = drude_local[i];
+    for (int j = nstore-1; j > 0; j--)
+      for (int k = 0; k < 3; k++) hist[i][3*j+k] = hist[i][3*(j-1)+k];
+    for (int k = 0; k < 3; k++) {
+      hist[i][k] = x[i][k] - x[icore][k];
+      if (correct) hist[i][k] += omega * f[i][k] / k_drude[type[i]];
+    }
+  }
+  if (nhist < nstore) nhist++;
+}
+
+/* ----------------------------------------------------------------------
+   memory usage of local atom-based array
+------------------------------------------------------------------------- */
+
+double FixDrudeASPC::memory_usage()
+{
+  return (double) atom->nmax * 3*nstore * sizeof(double);
+}
+
+/* ----------------------------------------------------------------------
+   allocate local atom-based array
+------------------------------------------------------------------------- */
+
+void FixDrudeASPC::grow_arrays(int nmax)
+{
+  memory->grow(hist,nmax,3*nstore,"drude/aspc:hist");
+}
+
+/* ----------------------------------------------------------------------
+   copy values within local atom-based array
+------------------------------------------------------------------------- */
+
+void FixDrudeASPC::copy_arrays(int i, int j, int delflag)
+{
+  for (int m = 0; m < 3*nstore; m++) hist[j][m] = hist[i][m];
+}
+
+/* ----------------------------------------------------------------------
+   pack values in local atom-based array for exchange with another proc
+------------------------------------------------------------------------- */
+
+int FixDrudeASPC::pack_exchange(int i, double *buf)
+{
+  for (int m = 0; m < 3*nstore; m++) buf[m] = hist[i][m];
+  return 3*nstore;
+}
+
+/* ----------------------------------------------------------------------
+   unpack values in local atom-based array from exchange with another proc
+------------------------------------------------------------------------- */
+
+int FixDrudeASPC::unpack_exchange(int nlocal, double *buf)
+{
+  for (int m = 0; m < 3*nstore; m++) hist[nlocal][m] = buf[m];
+  return 3*nstore;
+}
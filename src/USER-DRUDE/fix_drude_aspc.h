@@ -0,0 +1,80 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(drude/aspc,FixDrudeASPC)
+
+#else
+
+#ifndef LMP_FIX_DRUDE_ASPC_H
+#define LMP_FIX_DRUDE_ASPC_H
+
+#include "fix.h"
+#include "fix_drude.h"
+
+namespace LAMMPS_NS {
+
+class FixDrudeASPC : public Fix {
+ public:
+  FixDrudeASPC(class LAMMPS *, int, char **);
+  virtual ~FixDrudeASPC();
+  int setmask();
+  void init();
+  void setup(int);
+  void pre_force(int);
+  void post_force(int);
+
+  double memory_usage();
+  void grow_arrays(int);
+  void copy_arrays(int, int, int);
+  int pack_exchange(int, double *);
+  int unpack_exchange(int, double *);
+
+ protected:
+  int korder;            // order k of the predictor
+  int nstore;            // number of stored displacements, k+2
+  int nhist;             // number of displacements stored so far
+  int iorder;            // order used by the last prediction
+  int corrector;         // 1 to replace the SCF by one corrector step
+  double **coeff;        // predictor coefficients B_j for each order
+  double **hist;         // past Drude displacements, most recent first
+  double *k_drude;       // stiffness of the core-Drude bond per Drude type
+  FixDrude *fix_drude;
+
+  void record(int);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix drude/aspc requires fix drude
+
+Self-explanatory.
+
+E: Fix drude/aspc corrector requires a bond between each core and its Drude
+
+The stiffness of the core-Drude bonds is used by the corrector step
+and is taken from the bond style.
+
+*/
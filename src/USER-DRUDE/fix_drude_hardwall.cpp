@@ -0,0 +1,191 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <math.h>
+#include <string.h>
+#include "fix_drude_hardwall.h"
+#include "atom.h"
+#include "force.h"
+#include "comm.h"
+#include "domain.h"
+#include "modify.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+/* ---------------------------------------------------------------------- */
+
+FixDrudeHardwall::FixDrudeHardwall(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg)
+{
+  if (narg != 4) error->all(FLERR,"Illegal fix drude/hardwall command");
+
+  rmax = force->numeric(FLERR,arg[3]);
+  if (rmax <= 0.0) error->all(FLERR,"Illegal fix drude/hardwall command");
+
+  scalar_flag = 1;
+  global_freq = 1;
+  extscalar = 0;
+  comm_forward = 6;
+
+  ncollision = 0;
+  fix_drude = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixDrudeHardwall::setmask()
+{
+  int mask = 0;
+  mask |= POST_INTEGRATE;
+  return mask;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrudeHardwall::init()
+{
+  int ifix;
+  for (ifix = 0; ifix < modify->nfix; ifix++)
+    if (strcmp(modify->fix[ifix]->style,"drude") == 0) break;
+  if (ifix == modify->nfix)
+    error->all(FLERR,"Fix drude/hardwall requires fix drude");
+  fix_drude = (FixDrude *) modify->fix[ifix];
+}
+
+/* ----------------------------------------------------------------------
+   reflect the core-Drude pairs stretched beyond rmax on a hard wall
+   in the relative coordinate: the relative velocity along the bond is
+   reversed if it points outwards, and the distance is folded back
+   inside the wall, conserving the center of mass and its velocity.
+   The pair is seen the same way on the procs of the core and the Drude,
+   each of them updates its own atom.
+------------------------------------------------------------------------- */
+
+void FixDrudeHardwall::post_integrate()
+{
+  double **x = atom->x, **v = atom->v;
+  int *mask = atom->mask;
+  int *type = atom->type;
+  double *rmass = atom->rmass, *mass = atom->mass;
+  int nlocal = atom->nlocal;
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+
+  // positions and velocities of ghost partners were moved by the integrator
+
+  if (!fix_drude->partners_local) comm->forward_comm_fix(this);
+
+  for (int i = 0; i < nlocal; i++) {
+    if (drudetype[type[i]] == NOPOL_TYPE) continue;
+    int j = drude_local[i];
+    if (j < 0) error->one(FLERR,"Drude partner not found");
+    int icore = i, idrude = j;
+    if (drudetype[type[i]] == DRUDE_TYPE) {
+      icore = j;
+      idrude = i;
+    }
+    if (!(mask[icore] & groupbit)) continue;
+
+    double r[3];
+    for (int k = 0; k < 3; k++) r[k] = x[idrude][k] - x[icore][k];
+    double d = sqrt(r[0]*r[0] + r[1]*r[1] + r[2]*r[2]);
+    if (d <= rmax) continue;
+
+    double mcore, mdrude;
+    if (rmass) {
+      mcore = rmass[icore];
+      mdrude = rmass[idrude];
+    } else {
+      mcore = mass[type[icore]];
+      mdrude = mass[type[idrude]];
+    }
+    double mtot = mcore + mdrude;
+    double n[3];
+    for (int k = 0; k < 3; k++) n[k] = r[k] / d;
+
+    double vr = 0.0;
+    for (int k = 0; k < 3; k++) vr += (v[idrude][k] - v[icore][k]) * n[k];
+    if (vr < 0.0) vr = 0.0;
+    double dnew = 2.0*rmax - d;
+    if (dnew < 0.0) dnew = 0.0;
+
+    // own share of the change of relative position and velocity
+
+    double coeff = (i == icore) ? -mdrude / mtot : mcore / mtot;
+    for (int k = 0; k < 3; k++) {
+      x[i][k] += coeff * (dnew - d) * n[k];
+      v[i][k] -= coeff * 2.0 * vr * n[k];
+    }
+    if (i == icore) ncollision++;
+  }
+}
+
+/* ----------------------------------------------------------------------
+   total number of wall collisions since the fix was defined
+------------------------------------------------------------------------- */
+
+double FixDrudeHardwall::compute_scalar()
+{
+  double one = (double) ncollision, all;
+  MPI_Allreduce(&one, &all, 1, MPI_DOUBLE, MPI_SUM, world);
+  return all;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixDrudeHardwall::pack_forward_comm(int n, int *list, double *buf,
+                                        int pbc_flag, int *pbc)
+{
+  double **x = atom->x, **v = atom->v;
+  double dx = 0.0, dy = 0.0, dz = 0.0;
+  if (pbc_flag) {
+    dx = pbc[0]*domain->xprd;
+    dy = pbc[1]*domain->yprd;
+    dz = pbc[2]*domain->zprd;
+    if (domain->triclinic) {
+      dx += pbc[5]*domain->xy + pbc[4]*domain->xz;
+      dy += pbc[3]*domain->yz;
+    }
+  }
+
+  int m = 0;
+  for (int i = 0; i < n; i++) {
+    int j = list[i];
+    buf[m++] = x[j][0] + dx;
+    buf[m++] = x[j][1] + dy;
+    buf[m++] = x[j][2] + dz;
+    buf[m++] = v[j][0];
+    buf[m++] = v[j][1];
+    buf[m++] = v[j][2];
+  }
+  return m;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrudeHardwall::unpack_forward_comm(int n, int first, double *buf)
+{
+  double **x = atom->x, **v = atom->v;
+  int m = 0;
+  int last = first + n;
+  for (int i = first; i < last; i++) {
+    x[i][0] = buf[m++];
+    x[i][1] = buf[m++];
+    x[i][2] = buf[m++];
+    v[i][0] = buf[m++];
+    v[i][1] = buf[m++];
+    v[i][2] = buf[m++];
+  }
+}
@@ -0,0 +1,67 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(drude/hardwall,FixDrudeHardwall)
+
+#else
+
+#ifndef LMP_FIX_DRUDE_HARDWALL_H
+#define LMP_FIX_DRUDE_HARDWALL_H
+
+#include "fix.h"
+#include "fix_drude.h"
+
+namespace LAMMPS_NS {
+
+class FixDrudeHardwall : public Fix {
+ public:
+  FixDrudeHardwall(class LAMMPS *, int, char **);
+  virtual ~FixDrudeHardwall() {}
+  int setmask();
+  void init();
+  virtual void post_integrate();
+  double compute_scalar();
+  int pack_forward_comm(int, int *, double *, int, int *);
+  void unpack_forward_comm(int, int, double *);
+
+ protected:
+  double rmax;           // largest core-Drude distance
+  bigint ncollision;     // wall collisions counted on this proc
+  FixDrude *fix_drude;
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix drude/hardwall requires fix drude
+
+Self-explanatory.
+
+E: Drude partner not found
+
+The core or Drude partner of an atom is neither a local nor a ghost
+atom of this processor.
+
+*/
@@ -0,0 +1,363 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "fix_drude_scf.h"
+#include "atom.h"
+#include "force.h"
+#include "comm.h"
+#include "update.h"
+#include "modify.h"
+#include "pair.h"
+#include "bond.h"
+#include "angle.h"
+#include "dihedral.h"
+#include "improper.h"
+#include "kspace.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+
+/* ---------------------------------------------------------------------- */
+
+FixDrudeSCF::FixDrudeSCF(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg)
+{
+  if (narg < 5) error->all(FLERR,"Illegal fix drude/scf command");
+
+  tolerance = force->numeric(FLERR,arg[3]);
+  maxiter = force->inumeric(FLERR,arg[4]);
+  if (tolerance <= 0.0 || maxiter < 1)
+    error->all(FLERR,"Illegal fix drude/scf command");
+
+  multilevel = 0;
+  int iarg = 5;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"multilevel") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix drude/scf command");
+      if (strcmp(arg[iarg+1],"no") == 0) multilevel = 0;
+      else if (strcmp(arg[iarg+1],"yes") == 0) multilevel = 1;
+      else error->all(FLERR,"Illegal fix drude/scf command");
+      iarg += 2;
+    } else error->all(FLERR,"Illegal fix drude/scf command");
+  }
+
+  vector_flag = 1;
+  size_vector = 2;
+  global_freq = 1;
+  extvector = 0;
+
+  niter = 0;
+  fmax = 0.0;
+  fix_drude = NULL;
+  fix_omp = NULL;
+  k_drude = NULL;
+  nmax = 0;
+  res = dir = res1 = fkspace = NULL;
+  kfixed = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixDrudeSCF::~FixDrudeSCF()
+{
+  delete [] k_drude;
+  memory->destroy(res);
+  memory->destroy(dir);
+  memory->destroy(res1);
+  memory->destroy(fkspace);
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixDrudeSCF::setmask()
+{
+  int mask = 0;
+  mask |= POST_FORCE;
+  return mask;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrudeSCF::init()
+{
+  int ifix;
+  for (ifix = 0; ifix < modify->nfix; ifix++)
+    if (strcmp(modify->fix[ifix]->style,"drude") == 0) break;
+  if (ifix == modify->nfix) error->all(FLERR,"Fix drude/scf requires fix drude");
+  fix_drude = (FixDrude *) modify->fix[ifix];
+
+  if (!force->bond)
+    error->all(FLERR,"Fix drude/scf requires a bond between each core "
+               "and its Drude");
+
+  // with USER-OMP, the per-thread forces must be cleared before each
+  // evaluation, as done by the package fix before the force styles
+
+  fix_omp = NULL;
+  ifix = modify->find_fix("package_omp");
+  if (ifix >= 0) fix_omp = modify->fix[ifix];
+
+  // the per-thread forces are merged by the last threaded style,
+  // which is the k-space one when it is threaded
+
+  if (multilevel && fix_omp && force->kspace &&
+      strstr(force->kspace_style,"/omp"))
+    error->all(FLERR,"Fix drude/scf multilevel yes cannot be used "
+               "with a threaded kspace style");
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrudeSCF::setup(int vflag)
+{
+  setup_stiffness();
+  post_force(vflag);
+}
+
+/* ----------------------------------------------------------------------
+   stiffness of the core-Drude bonds, used as preconditioner
+------------------------------------------------------------------------- */
+
+void FixDrudeSCF::setup_stiffness()
+{
+  int *type = atom->type;
+  int *mask = atom->mask;
+  int nlocal = atom->nlocal;
+  int *drudetype = fix_drude->drudetype;
+
+  if (!k_drude) k_drude = new double[atom->ntypes+1];
+  fix_drude->bond_stiffness(k_drude);
+
+  int flag = 0, flag_all;
+  for (int i = 0; i < nlocal; i++)
+    if (mask[i] & groupbit && drudetype[type[i]] == DRUDE_TYPE &&
+        k_drude[type[i]] <= 0.0) flag = 1;
+  MPI_Allreduce(&flag, &flag_all, 1, MPI_INT, MPI_MAX, world);
+  if (flag_all)
+    error->all(FLERR,"Fix drude/scf requires a bond between each core "
+               "and its Drude");
+}
+
+/* ----------------------------------------------------------------------
+   relax the Drudes of the group to the minimum of the energy
+   with a conjugate gradient preconditioned by the core-Drude stiffness
+   each line search is a secant step using the forces at a trial point,
+   the residual at the minimum along the line is interpolated
+------------------------------------------------------------------------- */
+
+void FixDrudeSCF::post_force(int vflag)
+{
+  double **x = atom->x;
+  int *mask = atom->mask;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  int *drudetype = fix_drude->drudetype;
+
+  if (atom->nmax > nmax) {
+    memory->destroy(res);
+    memory->destroy(dir);
+    memory->destroy(res1);
+    memory->destroy(fkspace);
+    nmax = atom->nmax;
+    memory->create(res,nmax,3,"drude/scf:res");
+    memory->create(dir,nmax,3,"drude/scf:dir");
+    memory->create(res1,nmax,3,"drude/scf:res1");
+    memory->create(fkspace,nmax,3,"drude/scf:fkspace");
+  }
+
+  // energy and virial are tallied on the last force evaluation
+
+  int eflag = 0;
+  if (update->eflag_global == update->ntimestep) eflag |= 1;
+  if (update->eflag_atom == update->ntimestep) eflag |= 2;
+
+  kfixed = 0;
+  drude_forces(res);
+  fmax = max_force(res);
+
+  // multilevel: the k-space forces on the Drudes are the difference
+  // between the full forces and the short-range ones at the start
+
+  if (multilevel && force->kspace && fmax > tolerance) {
+    force_eval(0, 0, 0);
+    drude_forces(fkspace);
+    for (int i = 0; i < nlocal; i++)
+      for (int k = 0; k < 3; k++) fkspace[i][k] = res[i][k] - fkspace[i][k];
+    kfixed = 1;
+  }
+
+  for (int i = 0; i < nlocal; i++) {
+    for (int k = 0; k < 3; k++) dir[i][k] = 0.0;
+    if (!(mask[i] & groupbit) || drudetype[type[i]] != DRUDE_TYPE) continue;
+    for (int k = 0; k < 3; k++) dir[i][k] = res[i][k] / k_drude[type[i]];
+  }
+  double rz = dot(res, res, -1);
+
+  int evaluated = 1;
+  for (niter = 0; niter < maxiter && fmax > tolerance; niter++) {
+    // trial step to the minimum of the bond energy along dir
+
+    double alpha0 = rz / dot(dir, dir, 1);
+    for (int i = 0; i < nlocal; i++)
+      for (int k = 0; k < 3; k++) x[i][k] += alpha0 * dir[i][k];
+    force_eval(0, 0, !kfixed);
+    drude_forces(res1);
+
+    // secant correction of the step if the curvature is positive
+
+    double rd0 = dot(res, dir, 0);
+    double rd1 = dot(res1, dir, 0);
+    double ratio = 1.0;
+    if (rd0 > rd1) ratio = rd0 / (rd0 - rd1);
+    evaluated = (ratio == 1.0);
+    for (int i = 0; i < nlocal; i++)
+      for (int k = 0; k < 3; k++) {
+        x[i][k] += (ratio - 1.0) * alpha0 * dir[i][k];
+        res[i][k] += ratio * (res1[i][k] - res[i][k]);
+      }
+
+    // Fletcher-Reeves update of the preconditioned direction
+
+    double rznew = dot(res, res, -1);
+    double beta = rznew / rz;
+    rz = rznew;
+    for (int i = 0; i < nlocal; i++) {
+      if (!(mask[i] & groupbit) || drudetype[type[i]] != DRUDE_TYPE) continue;
+      for (int k = 0; k < 3; k++)
+        dir[i][k] = res[i][k] / k_drude[type[i]] + beta * dir[i][k];
+    }
+    fmax = max_force(res);
+  }
+
+  // forces, energy and virial at the final Drude positions
+  // with multilevel this is the k-space solve of the step
+
+  if (niter > 0 && (!evaluated || kfixed || eflag || vflag)) {
+    force_eval(eflag, vflag, 1);
+    kfixed = 0;
+    drude_forces(res);
+    fmax = max_force(res);
+  }
+
+  if (fmax > tolerance && comm->me == 0) {
+    char str[128];
+    sprintf(str,"Fix drude/scf did not converge after %d iterations "
+            "at step " BIGINT_FORMAT,niter,update->ntimestep);
+    error->warning(FLERR,str);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   recompute all forces after the Drudes have been displaced
+   same sequence as in Verlet, without the fixes
+   except the USER-OMP one that clears the per-thread forces
+   kflag = 0 skips the k-space solve
+------------------------------------------------------------------------- */
+
+void FixDrudeSCF::force_eval(int eflag, int vflag, int kflag)
+{
+  comm->forward_comm();
+
+  size_t nbytes = sizeof(double) * atom->nlocal;
+  if (force->newton) nbytes += sizeof(double) * atom->nghost;
+  if (nbytes) memset(&atom->f[0][0],0,3*nbytes);
+  if (fix_omp) fix_omp->pre_force(vflag);
+
+  if (force->pair) force->pair->compute(eflag,vflag);
+  if (atom->molecular) {
+    if (force->bond) force->bond->compute(eflag,vflag);
+    if (force->angle) force->angle->compute(eflag,vflag);
+    if (force->dihedral) force->dihedral->compute(eflag,vflag);
+    if (force->improper) force->improper->compute(eflag,vflag);
+  }
+  if (force->kspace && kflag) force->kspace->compute(eflag,vflag);
+  if (force->newton) comm->reverse_comm();
+}
+
+/* ----------------------------------------------------------------------
+   forces on the Drudes of the group, zero on other atoms
+   the fixed k-space forces are added when the solve is skipped
+------------------------------------------------------------------------- */
+
+void FixDrudeSCF::drude_forces(double **r)
+{
+  double **f = atom->f;
+  int *mask = atom->mask;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  int *drudetype = fix_drude->drudetype;
+
+  for (int i = 0; i < nlocal; i++) {
+    for (int k = 0; k < 3; k++) r[i][k] = 0.0;
+    if (!(mask[i] & groupbit) || drudetype[type[i]] != DRUDE_TYPE) continue;
+    for (int k = 0; k < 3; k++) r[i][k] = f[i][k];
+    if (kfixed)
+      for (int k = 0; k < 3; k++) r[i][k] += fkspace[i][k];
+  }
+}
+
+/* ----------------------------------------------------------------------
+   global dot product over the Drudes of the group,
+   weighted by the stiffness to the given power (-1, 0 or 1)
+------------------------------------------------------------------------- */
+
+double FixDrudeSCF::dot(double **a, double **b, int power)
+{
+  int *mask = atom->mask;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  int *drudetype = fix_drude->drudetype;
+
+  double sum = 0.0, sum_all;
+  for (int i = 0; i < nlocal; i++) {
+    if (!(mask[i] & groupbit) || drudetype[type[i]] != DRUDE_TYPE) continue;
+    double w = 1.0;
+    if (power == 1) w = k_drude[type[i]];
+    else if (power == -1) w = 1.0 / k_drude[type[i]];
+    sum += w * (a[i][0]*b[i][0] + a[i][1]*b[i][1] + a[i][2]*b[i][2]);
+  }
+  MPI_Allreduce(&sum, &sum_all, 1, MPI_DOUBLE, MPI_SUM, world);
+  return sum_all;
+}
+
+/* ----------------------------------------------------------------------
+   largest norm of a per-Drude vector over all procs
+------------------------------------------------------------------------- */
+
+double FixDrudeSCF::max_force(double **a)
+{
+  int nlocal = atom->nlocal;
+
+  double fmaxsq = 0.0, fmaxsq_all;
+  for (int i = 0; i < nlocal; i++)
+    fmaxsq = MAX(fmaxsq, a[i][0]*a[i][0] + a[i][1]*a[i][1] + a[i][2]*a[i][2]);
+  MPI_Allreduce(&fmaxsq, &fmaxsq_all, 1, MPI_DOUBLE, MPI_MAX, world);
+  return sqrt(fmaxsq_all);
+}
+
+/* ----------------------------------------------------------------------
+   number of iterations and largest force on a Drude on last step
+------------------------------------------------------------------------- */
+
+double FixDrudeSCF::compute_vector(int n)
+{
+  if (n == 0) return (double) niter;
+  return fmax;
+}
@@ -0,0 +1,93 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(drude/scf,FixDrudeSCF)
+
+#else
+
+#ifndef LMP_FIX_DRUDE_SCF_H
+#define LMP_FIX_DRUDE_SCF_H
+
+#include "fix.h"
+#include "fix_drude.h"
+
+namespace LAMMPS_NS {
+
+class FixDrudeSCF : public Fix {
+ public:
+  FixDrudeSCF(class LAMMPS *, int, char **);
+  virtual ~FixDrudeSCF();
+  int setmask();
+  void init();
+  void setup(int);
+  virtual void post_force(int);
+  double compute_vector(int);
+
+ protected:
+  double tolerance;      // convergence criterion on the Drude forces
+  int maxiter;           // maximum number of CG iterations per step
+  int multilevel;        // 1 if k-space forces are fixed during iterations
+  int kfixed;            // 1 while fkspace replaces the k-space solve
+  int niter;             // iterations done on last step
+  double fmax;           // largest force on a Drude after last step
+  FixDrude *fix_drude;
+  class Fix *fix_omp;      // USER-OMP package fix, if defined
+
+  double *k_drude;       // stiffness of the core-Drude bond per Drude type
+  int nmax;
+  double **res, **dir, **res1;  // CG residual, direction, trial residual
+  double **fkspace;      // k-space forces on the Drudes at start of step
+
+  void setup_stiffness();
+  void force_eval(int, int, int);
+  void drude_forces(double **);
+  double dot(double **, double **, int);
+  double max_force(double **);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix drude/scf requires fix drude
+
+Self-explanatory.
+
+E: Fix drude/scf requires a bond between each core and its Drude
+
+The stiffness of the core-Drude bonds is used to precondition the
+conjugate gradient and is taken from the bond style.
+
+E: Fix drude/scf multilevel yes cannot be used with a threaded kspace style
+
+With USER-OMP, the forces computed by each thread are summed by the
+last threaded style of a force evaluation.  This is the kspace style
+when it is threaded, and it is skipped by the multilevel iterations.
+
+W: Fix drude/scf did not converge
+
+The maximum number of iterations was reached before the largest force
+on the Drude particles fell below the tolerance.
+
+*/
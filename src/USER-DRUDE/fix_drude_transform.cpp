@@ -20,6 +20,7 @@
 #include "error.h"
 #include "modify.h"
 #include "force.h"
+#include "memory.h"
 
 #include <string.h>
 
@@ -34,6 +35,9 @@ FixDrudeTransform<inverse>::FixDrudeTransform(LAMMPS *lmp, int narg, char **arg)
   if (narg != 3) error->all(FLERR,"Illegal fix drude/transform command");
   comm_forward = 9;
   fix_drude = NULL;
+  remote = NULL;
+  nmax = 0;
+  commflag = 0;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -41,6 +45,7 @@ template <bool inverse>
 FixDrudeTransform<inverse>::~FixDrudeTransform()
 {
   if (mcoeff) delete [] mcoeff;
+  memory->destroy(remote);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -61,9 +66,47 @@ int FixDrudeTransform<inverse>::setmask()
   int mask = 0;
   mask |= INITIAL_INTEGRATE;
   mask |= FINAL_INTEGRATE;
+  mask |= PRE_NEIGHBOR;
   return mask;
 }
 
+/* ---------------------------------------------------------------------- */
+template <bool inverse>
+void FixDrudeTransform<inverse>::setup_pre_neighbor()
+{
+  pre_neighbor();
+}
+
+/* ----------------------------------------------------------------------
+   flag the atoms whose Drude partner is a ghost: only those are needed
+   as ghosts by the proc of their partner. The flags are sent once to
+   the ghost atoms, so that the forward communication of each step only
+   contains the flagged atoms.
+------------------------------------------------------------------------- */
+template <bool inverse>
+void FixDrudeTransform<inverse>::pre_neighbor()
+{
+  int nlocal = atom->nlocal;
+  int * type = atom->type;
+  int * drudetype = fix_drude->drudetype;
+  int * drude_local = fix_drude->drude_local;
+
+  if (fix_drude->partners_local) return;
+
+  if (atom->nmax > nmax) {
+    memory->destroy(remote);
+    nmax = atom->nmax;
+    memory->create(remote,nmax,"drude/transform:remote");
+  }
+
+  for (int i=0; i<nlocal; i++)
+    remote[i] = (drudetype[type[i]] != NOPOL_TYPE && drude_local[i] >= nlocal);
+
+  commflag = 1;
+  comm->forward_comm_fix(this);
+  commflag = 0;
+}
+
 /* ---------------------------------------------------------------------- */
 template <bool inverse>
 void FixDrudeTransform<inverse>::setup(int) {
@@ -71,7 +114,7 @@ void FixDrudeTransform<inverse>::setup(int) {
   int ntypes = atom->ntypes;
   int * type = atom->type;
   double * rmass = atom->rmass, * mass = atom->mass;
-  tagint * drudeid = fix_drude->drudeid;
+  int * drude_local = fix_drude->drude_local;
   int * drudetype = fix_drude->drudetype;
 
   if (!rmass) {
@@ -80,7 +123,7 @@ void FixDrudeTransform<inverse>::setup(int) {
     for (int itype=0; itype<=ntypes; itype++) mcoeff_loc[itype] = 2.; // an impossible value: mcoeff is at most 1.
     for (int i=0; i<nlocal; i++) {
       if (drudetype[type[i]] == DRUDE_TYPE) {
-        int j = atom->map(drudeid[i]);
+        int j = drude_local[i];
         // i is drude, j is core
         if (mcoeff_loc[type[i]] < 1.5) { // already done
           if (mcoeff_loc[type[j]] > 1.5){ // not yet done ??
@@ -103,28 +146,28 @@ void FixDrudeTransform<inverse>::setup(int) {
 namespace LAMMPS_NS { // required for specialization
 template <>
 void FixDrudeTransform<false>::initial_integrate(int){
-  comm->forward_comm_fix(this);
+  if (!fix_drude->partners_local) comm->forward_comm_fix(this);
   real_to_reduced();
   //comm->forward_comm_fix(this); // Normally not needed
 }
 
 template <>
 void FixDrudeTransform<false>::final_integrate(){
-  comm->forward_comm_fix(this);
+  if (!fix_drude->partners_local) comm->forward_comm_fix(this);
   real_to_reduced();
   //comm->forward_comm_fix(this); // Normally not needed
 }
 
 template <>
 void FixDrudeTransform<true>::initial_integrate(int){
-  comm->forward_comm_fix(this);
+  if (!fix_drude->partners_local) comm->forward_comm_fix(this);
   reduced_to_real();
   //comm->forward_comm_fix(this); // Normally not needed
 }
 
 template <>
 void FixDrudeTransform<true>::final_integrate(){
-  comm->forward_comm_fix(this);
+  if (!fix_drude->partners_local) comm->forward_comm_fix(this);
   reduced_to_real();
   //comm->forward_comm_fix(this); // Normally not needed
 }
@@ -143,7 +186,7 @@ void FixDrudeTransform<inverse>::real_to_reduced()
   double * rmass = atom->rmass, * mass = atom->mass;
   double mcore, mdrude, coeff;
   int icore, idrude;
-  tagint * drudeid = fix_drude->drudeid;
+  int * drude_local = fix_drude->drude_local;
   int * drudetype = fix_drude->drudetype;
 
   if (!rmass) { // TODO: maybe drudetype can be used instead?
@@ -152,12 +195,7 @@ void FixDrudeTransform<inverse>::real_to_reduced()
   }
   for (int i=0; i<nlocal; i++) {
     if (mask[i] & groupbit && drudetype[type[i]] != NOPOL_TYPE) {
-      drudeid[i] = (tagint) domain->closest_image(i, atom->map(drudeid[i]));
-    }
-  }
-  for (int i=0; i<nlocal; i++) {
-    if (mask[i] & groupbit && drudetype[type[i]] != NOPOL_TYPE) {
-      int j = (int) drudeid[i];
+      int j = drude_local[i];
       if (drudetype[type[i]] == DRUDE_TYPE && j < nlocal) continue;
 
       if (drudetype[type[i]] == DRUDE_TYPE) {
@@ -201,12 +239,12 @@ void FixDrudeTransform<inverse>::reduced_to_real()
   double * rmass = atom->rmass, * mass = atom->mass;
   double mcore, mdrude, coeff;
   int icore, idrude;
-  tagint * drudeid = fix_drude->drudeid;
+  int * drude_local = fix_drude->drude_local;
   int * drudetype = fix_drude->drudetype;
 
   for (int i=0; i<nlocal; i++) {
     if (mask[i] & groupbit && drudetype[type[i]] != NOPOL_TYPE) {
-      int j = (int) drudeid[i]; // local index of drude partner because drudeid is in reduced form
+      int j = drude_local[i];
       if (drudetype[type[i]] == DRUDE_TYPE && j < nlocal) continue;
 
       if (drudetype[type[i]] == DRUDE_TYPE) {
@@ -244,11 +282,6 @@ void FixDrudeTransform<inverse>::reduced_to_real()
       }
     }
   }
-  for (int i=0; i<nlocal; i++) {
-    if (mask[i] & groupbit && drudetype[type[i]] != NOPOL_TYPE) {
-      drudeid[i] = atom->tag[(int) drudeid[i]];
-    }
-  }
   if (!rmass) {
     for (int itype=1; itype<=ntypes; itype++)
       if (mcoeff[itype] < 1.5) mass[itype] /= 1. - mcoeff[itype];
@@ -265,8 +298,15 @@ int FixDrudeTransform<inverse>::pack_forward_comm(int n, int *list, double *buf,
   double dx,dy,dz;
   int dim = domain->dimension;
   int m = 0;
+
+  if (commflag) {
+    for (int i=0; i<n; i++) buf[m++] = remote[list[i]];
+    return m;
+  }
+
   for (int i=0; i<n; i++) {
     int j = list[i];
+    if (!remote[j]) continue;
     if (pbc_flag == 0 ||
         (fix_drude->is_reduced && drudetype[type[j]] == DRUDE_TYPE)) {
         for (int k=0; k<dim; k++) buf[m++] = x[j][k];
@@ -306,7 +346,14 @@ void FixDrudeTransform<inverse>::unpack_forward_comm(int n, int first, double *b
   int dim = domain->dimension;
   int m = 0;
   int last = first + n;
+
+  if (commflag) {
+    for (int i=first; i<last; i++) remote[i] = (int) buf[m++];
+    return;
+  }
+
   for (int i=first; i<last; i++) {
+    if (!remote[i]) continue;
     for (int k=0; k<dim; k++) x[i][k] = buf[m++];
     for (int k=0; k<dim; k++) v[i][k] = buf[m++];
     for (int k=0; k<dim; k++) f[i][k] = buf[m++];
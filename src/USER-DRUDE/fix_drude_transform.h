@@ -34,6 +34,8 @@ class FixDrudeTransform : public Fix {
   int setmask();
   void init();
   void setup(int vflag);
+  void setup_pre_neighbor();
+  void pre_neighbor();
   void reduced_to_real();
   void real_to_reduced();
   void initial_integrate(int vflag);
@@ -43,6 +45,9 @@ class FixDrudeTransform : public Fix {
  protected:
   double * mcoeff;
   FixDrude * fix_drude;
+  int * remote;        // 1 if Drude partner is not owned locally
+  int nmax;
+  int commflag;        // 1 to communicate remote flags, 0 for x, v, f
 };
 
 }
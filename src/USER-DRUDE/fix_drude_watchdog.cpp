@@ -0,0 +1,326 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "fix_drude_watchdog.h"
+#include "atom.h"
+#include "force.h"
+#include "pair.h"
+#include "comm.h"
+#include "update.h"
+#include "integrate.h"
+#include "group.h"
+#include "modify.h"
+#include "compute.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+#define NSNAP 10 // x, v, f and image per atom
+#define BIG 1.0e20
+
+/* ---------------------------------------------------------------------- */
+
+FixDrudeWatchdog::FixDrudeWatchdog(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg)
+{
+  if (narg != 9) error->all(FLERR,"Illegal fix drude/watchdog command");
+
+  nevery = force->inumeric(FLERR,arg[3]);
+  dmax = force->numeric(FLERR,arg[4]);
+  tmax = force->numeric(FLERR,arg[5]);
+  nsnapshot = force->inumeric(FLERR,arg[6]);
+  dtfactor = force->numeric(FLERR,arg[7]);
+  nwindow = force->inumeric(FLERR,arg[8]);
+  if (nevery <= 0 || dmax <= 0.0 || tmax <= 0.0 || nwindow < 0)
+    error->all(FLERR,"Illegal fix drude/watchdog command");
+  if (nsnapshot <= 0 || nsnapshot % nevery)
+    error->all(FLERR,"Illegal fix drude/watchdog command");
+  if (dtfactor <= 0.0 || dtfactor > 1.0)
+    error->all(FLERR,"Illegal fix drude/watchdog command");
+
+  scalar_flag = 1;
+  global_freq = nevery;
+  extscalar = 0;
+  force_reneighbor = 1;
+  next_reneighbor = -1;
+
+  // create a new compute temp/drude style
+  // id = fix-ID + temp
+  // its second vector element is the temperature of the Drude oscillators
+
+  int n = strlen(id) + 6;
+  id_temp = new char[n];
+  strcpy(id_temp,id);
+  strcat(id_temp,"_temp");
+
+  char **newarg = new char*[3];
+  newarg[0] = id_temp;
+  newarg[1] = group->names[igroup];
+  newarg[2] = (char *) "temp/drude";
+
+  modify->add_compute(3,newarg);
+  delete [] newarg;
+
+  dt_orig = 0.0;
+  last_rollback = last_snapshot = -1;
+  nrollback = 0;
+  respaflag = 0;
+  fix_drude = NULL;
+  temperature = NULL;
+
+  snapshot = NULL;
+  grow_arrays(atom->nmax);
+  atom->add_callback(0);
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixDrudeWatchdog::~FixDrudeWatchdog()
+{
+  atom->delete_callback(id,0);
+  memory->destroy(snapshot);
+
+  // delete temperature compute if fix created it
+
+  modify->delete_compute(id_temp);
+  delete [] id_temp;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixDrudeWatchdog::setmask()
+{
+  int mask = 0;
+  mask |= END_OF_STEP;
+  return mask;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrudeWatchdog::init()
+{
+  int ifix;
+  for (ifix = 0; ifix < modify->nfix; ifix++)
+    if (strcmp(modify->fix[ifix]->style,"drude") == 0) break;
+  if (ifix == modify->nfix)
+    error->all(FLERR,"Fix drude/watchdog requires fix drude");
+  fix_drude = (FixDrude *) modify->fix[ifix];
+
+  int icompute = modify->find_compute(id_temp);
+  if (icompute < 0)
+    error->all(FLERR,"Temperature ID for fix drude/watchdog does not exist");
+  temperature = modify->compute[icompute];
+
+  respaflag = 0;
+  if (strstr(update->integrate_style,"respa")) respaflag = 1;
+}
+
+/* ----------------------------------------------------------------------
+   the initial state is the first snapshot if it is sane
+------------------------------------------------------------------------- */
+
+void FixDrudeWatchdog::setup(int vflag)
+{
+  last_snapshot = -1;
+  if (!breach()) take_snapshot();
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDrudeWatchdog::end_of_step()
+{
+  if (breach()) {
+    rollback();
+    return;
+  }
+
+  // restore the timestep once the window after the last rollback is over
+
+  if (last_rollback >= 0 && update->ntimestep - last_rollback >= nwindow) {
+    set_dt(dt_orig);
+    last_rollback = -1;
+  }
+
+  if (update->ntimestep % nsnapshot == 0) take_snapshot();
+}
+
+/* ----------------------------------------------------------------------
+   return 1 if the largest core-Drude distance or the Drude temperature
+   is above its threshold, or is not a number
+   a core whose Drude is not even a ghost atom is a breach
+------------------------------------------------------------------------- */
+
+int FixDrudeWatchdog::breach()
+{
+  double **x = atom->x;
+  int *mask = atom->mask;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+
+  double dsq = 0.0, dsq_all;
+  for (int i = 0; i < nlocal; i++) {
+    if (!(mask[i] & groupbit) || drudetype[type[i]] != CORE_TYPE) continue;
+    int j = drude_local[i];
+    if (j < 0) {
+      dsq = BIG;
+      continue;
+    }
+    double delx = x[j][0] - x[i][0];
+    double dely = x[j][1] - x[i][1];
+    double delz = x[j][2] - x[i][2];
+    double rsq = delx*delx + dely*dely + delz*delz;
+    if (!(rsq <= dsq)) dsq = rsq;
+  }
+  MPI_Allreduce(&dsq, &dsq_all, 1, MPI_DOUBLE, MPI_MAX, world);
+
+  temperature->compute_vector();
+  double tdrude = temperature->vector[1];
+
+  return !(dsq_all <= dmax*dmax) || !(tdrude <= tmax);
+}
+
+/* ----------------------------------------------------------------------
+   store x, v, f and image of all local atoms, they migrate with the atoms
+   f are the forces of the next initial integration
+------------------------------------------------------------------------- */
+
+void FixDrudeWatchdog::take_snapshot()
+{
+  double **x = atom->x, **v = atom->v, **f = atom->f;
+  imageint *image = atom->image;
+  int nlocal = atom->nlocal;
+
+  for (int i = 0; i < nlocal; i++) {
+    for (int k = 0; k < 3; k++) {
+      snapshot[i][k] = x[i][k];
+      snapshot[i][3+k] = v[i][k];
+      snapshot[i][6+k] = f[i][k];
+    }
+    snapshot[i][9] = ubuf(image[i]).d;
+  }
+  last_snapshot = update->ntimestep;
+}
+
+/* ----------------------------------------------------------------------
+   restore the last snapshot and reduce the timestep
+   atoms may be outside their sub-domain, so reneighboring is forced
+------------------------------------------------------------------------- */
+
+void FixDrudeWatchdog::rollback()
+{
+  if (last_snapshot < 0)
+    error->all(FLERR,"Fix drude/watchdog detected a polarization "
+               "catastrophe before the first snapshot");
+
+  double **x = atom->x, **v = atom->v, **f = atom->f;
+  imageint *image = atom->image;
+  int nlocal = atom->nlocal;
+
+  for (int i = 0; i < nlocal; i++) {
+    for (int k = 0; k < 3; k++) {
+      x[i][k] = snapshot[i][k];
+      v[i][k] = snapshot[i][3+k];
+      f[i][k] = snapshot[i][6+k];
+    }
+    image[i] = (imageint) ubuf(snapshot[i][9]).i;
+  }
+  next_reneighbor = update->ntimestep + 1;
+
+  if (last_rollback < 0) dt_orig = update->dt;
+  set_dt(update->dt * dtfactor);
+  last_rollback = update->ntimestep;
+  nrollback++;
+
+  if (comm->me == 0) {
+    char str[128];
+    sprintf(str,"Fix drude/watchdog rolled back to step " BIGINT_FORMAT
+            " at step " BIGINT_FORMAT ", timestep is now %g",
+            last_snapshot,update->ntimestep,update->dt);
+    error->warning(FLERR,str);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   change the timestep as fix dt/reset does
+------------------------------------------------------------------------- */
+
+void FixDrudeWatchdog::set_dt(double dt)
+{
+  update->dt = dt;
+  if (respaflag) update->integrate->reset_dt();
+  if (force->pair) force->pair->reset_dt();
+  for (int i = 0; i < modify->nfix; i++) modify->fix[i]->reset_dt();
+}
+
+/* ----------------------------------------------------------------------
+   number of rollbacks since the fix was defined
+------------------------------------------------------------------------- */
+
+double FixDrudeWatchdog::compute_scalar()
+{
+  return (double) nrollback;
+}
+
+/* ----------------------------------------------------------------------
+   memory usage of local atom-based array
+------------------------------------------------------------------------- */
+
+double FixDrudeWatchdog::memory_usage()
+{
+  return (double) atom->nmax * NSNAP * sizeof(double);
+}
+
+/* ----------------------------------------------------------------------
+   allocate local atom-based array
+------------------------------------------------------------------------- */
+
+void FixDrudeWatchdog::grow_arrays(int nmax)
+{
+  memory->grow(snapshot,nmax,NSNAP,"drude/watchdog:snapshot");
+}
+
+/* ----------------------------------------------------------------------
+   copy values within local atom-based array
+------------------------------------------------------------------------- */
+
+void FixDrudeWatchdog::copy_arrays(int i, int j, int delflag)
+{
+  for (int m = 0; m < NSNAP; m++) snapshot[j][m] = snapshot[i][m];
+}
+
+/* ----------------------------------------------------------------------
+   pack values in local atom-based array for exchange with another proc
+------------------------------------------------------------------------- */
+
+int FixDrudeWatchdog::pack_exchange(int i, double *buf)
+{
+  for (int m = 0; m < NSNAP; m++) buf[m] = snapshot[i][m];
+  return NSNAP;
+}
+
+/* ----------------------------------------------------------------------
+   unpack values in local atom-based array from exchange with another proc
+------------------------------------------------------------------------- */
+
+int FixDrudeWatchdog::unpack_exchange(int nlocal, double *buf)
+{
+  for (int m = 0; m < NSNAP; m++) snapshot[nlocal][m] = buf[m];
+  return NSNAP;
+}
@@ -0,0 +1,99 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(drude/watchdog,FixDrudeWatchdog)
+
+#else
+
+#ifndef LMP_FIX_DRUDE_WATCHDOG_H
+#define LMP_FIX_DRUDE_WATCHDOG_H
+
+#include "fix.h"
+#include "fix_drude.h"
+
+namespace LAMMPS_NS {
+
+class FixDrudeWatchdog : public Fix {
+ public:
+  FixDrudeWatchdog(class LAMMPS *, int, char **);
+  virtual ~FixDrudeWatchdog();
+  int setmask();
+  void init();
+  void setup(int);
+  void end_of_step();
+  double compute_scalar();
+
+  double memory_usage();
+  void grow_arrays(int);
+  void copy_arrays(int, int, int);
+  int pack_exchange(int, double *);
+  int unpack_exchange(int, double *);
+
+ protected:
+  double dmax;           // largest allowed core-Drude distance
+  double tmax;           // largest allowed Drude temperature
+  int nsnapshot;         // steps between snapshots
+  double dtfactor;       // timestep reduction after a rollback
+  int nwindow;           // steps before the timestep is restored
+  double dt_orig;        // timestep before the first rollback
+  bigint last_rollback;  // step of the last rollback, -1 if none
+  bigint last_snapshot;  // step of the last snapshot, -1 if none
+  int nrollback;         // number of rollbacks since the fix was defined
+  int respaflag;         // 1 if the integrator is rRESPA
+  double **snapshot;     // x, v, f and image of each atom at last snapshot
+
+  FixDrude *fix_drude;
+  char *id_temp;
+  class Compute *temperature;
+
+  int breach();
+  void take_snapshot();
+  void rollback();
+  void set_dt(double);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix drude/watchdog requires fix drude
+
+Self-explanatory.
+
+E: Temperature ID for fix drude/watchdog does not exist
+
+Self-explanatory.
+
+E: Fix drude/watchdog detected a polarization catastrophe before the first snapshot
+
+The thresholds were exceeded at the start of the run, so there is no
+state to roll back to.
+
+W: Fix drude/watchdog rolled back to step ...
+
+The largest core-Drude distance or the Drude temperature exceeded its
+threshold.  The positions, velocities and images of the atoms have been
+restored to those of the last snapshot and the timestep reduced.
+
+*/
@@ -0,0 +1,266 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fix_dt_reset_drude.h"
+#include "atom.h"
+#include "update.h"
+#include "integrate.h"
+#include "comm.h"
+#include "domain.h"
+#include "force.h"
+#include "pair.h"
+#include "output.h"
+#include "dump.h"
+#include "modify.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+#define BIG 1.0e20
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+
+/* ---------------------------------------------------------------------- */
+
+FixDtResetDrude::FixDtResetDrude(LAMMPS *lmp, int narg, char **arg) :
+  Fix(lmp, narg, arg)
+{
+  if (narg < 7) error->all(FLERR,"Illegal fix dt/reset/drude command");
+
+  // set time_depend, else elapsed time accumulation can be messed up
+
+  time_depend = 1;
+  scalar_flag = 1;
+  global_freq = 1;
+  extscalar = 0;
+  comm_forward = 6;
+
+  nevery = force->inumeric(FLERR,arg[3]);
+  if (nevery <= 0) error->all(FLERR,"Illegal fix dt/reset/drude command");
+
+  minbound = maxbound = 1;
+  tmin = tmax = 0.0;
+  if (strcmp(arg[4],"NULL") == 0) minbound = 0;
+  else tmin = force->numeric(FLERR,arg[4]);
+  if (strcmp(arg[5],"NULL") == 0) maxbound = 0;
+  else tmax = force->numeric(FLERR,arg[5]);
+  xmax = force->numeric(FLERR,arg[6]);
+
+  if (minbound && tmin < 0.0)
+    error->all(FLERR,"Illegal fix dt/reset/drude command");
+  if (maxbound && tmax < 0.0)
+    error->all(FLERR,"Illegal fix dt/reset/drude command");
+  if (minbound && maxbound && tmin >= tmax)
+    error->all(FLERR,"Illegal fix dt/reset/drude command");
+  if (xmax <= 0.0) error->all(FLERR,"Illegal fix dt/reset/drude command");
+
+  dlimit = 0.0;
+  int iarg = 7;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"dlimit") == 0) {
+      if (iarg+2 > narg)
+        error->all(FLERR,"Illegal fix dt/reset/drude command");
+      dlimit = force->numeric(FLERR,arg[iarg+1]);
+      if (dlimit <= 0.0)
+        error->all(FLERR,"Illegal fix dt/reset/drude command");
+      iarg += 2;
+    } else error->all(FLERR,"Illegal fix dt/reset/drude command");
+  }
+
+  // a pair beyond dlimit asks for a zero timestep
+
+  if (dlimit > 0.0 && !minbound)
+    error->all(FLERR,"Fix dt/reset/drude dlimit requires a minimum timestep");
+
+  // initializations
+
+  laststep = update->ntimestep;
+  fix_drude = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixDtResetDrude::setmask()
+{
+  int mask = 0;
+  mask |= END_OF_STEP;
+  return mask;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDtResetDrude::init()
+{
+  int ifix;
+  for (ifix = 0; ifix < modify->nfix; ifix++)
+    if (strcmp(modify->fix[ifix]->style,"drude") == 0) break;
+  if (ifix == modify->nfix)
+    error->all(FLERR,"Fix dt/reset/drude requires fix drude");
+  fix_drude = (FixDrude *) modify->fix[ifix];
+
+  // set rRESPA flag
+
+  respaflag = 0;
+  if (strstr(update->integrate_style,"respa")) respaflag = 1;
+
+  // check for DCD or XTC dumps
+
+  for (int i = 0; i < output->ndump; i++)
+    if ((strcmp(output->dump[i]->style,"dcd") == 0 ||
+        strcmp(output->dump[i]->style,"xtc") == 0) && comm->me == 0)
+      error->warning(FLERR,
+                     "Dump dcd/xtc timestamp may be wrong with fix dt/reset/drude");
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDtResetDrude::setup(int vflag)
+{
+  end_of_step();
+}
+
+/* ----------------------------------------------------------------------
+   largest timestep for which the relative coordinate of each core-Drude
+   pair moves by less than xmax, and does not reach dlimit if set:
+   |v_rel| dt + 1/2 |a_rel| dt^2 = min(xmax, dlimit - |r_rel|)
+------------------------------------------------------------------------- */
+
+void FixDtResetDrude::end_of_step()
+{
+  double dt,dtv,dtf,dtsq;
+  double vsq,fsq,rsq;
+  double delx,dely,delz,delr;
+
+  double **x = atom->x;
+  double **v = atom->v;
+  double **f = atom->f;
+  double *mass = atom->mass;
+  double *rmass = atom->rmass;
+  int *type = atom->type;
+  int *mask = atom->mask;
+  int nlocal = atom->nlocal;
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+  double ftm2v = force->ftm2v;
+
+  // velocities and forces of ghost partners are not current
+
+  if (!fix_drude->partners_local) comm->forward_comm_fix(this);
+
+  double dtmin = BIG;
+
+  for (int i = 0; i < nlocal; i++) {
+    if (!(mask[i] & groupbit) || drudetype[type[i]] != CORE_TYPE) continue;
+    int j = drude_local[i];
+    if (j < 0) continue;
+
+    double vrel[3], arel[3];
+    for (int k = 0; k < 3; k++) {
+      vrel[k] = v[j][k] - v[i][k];
+      if (rmass) arel[k] = ftm2v * (f[j][k]/rmass[j] - f[i][k]/rmass[i]);
+      else arel[k] = ftm2v * (f[j][k]/mass[type[j]] - f[i][k]/mass[type[i]]);
+    }
+    vsq = vrel[0]*vrel[0] + vrel[1]*vrel[1] + vrel[2]*vrel[2];
+    fsq = arel[0]*arel[0] + arel[1]*arel[1] + arel[2]*arel[2];
+
+    double xallow = xmax;
+    if (dlimit > 0.0) {
+      delx = x[j][0] - x[i][0];
+      dely = x[j][1] - x[i][1];
+      delz = x[j][2] - x[i][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+      delr = dlimit - sqrt(rsq);
+      if (delr < xallow) xallow = delr;
+      if (xallow <= 0.0) {
+        dtmin = 0.0;
+        continue;
+      }
+    }
+
+    dtv = dtf = BIG;
+    if (vsq > 0.0) dtv = xallow / sqrt(vsq);
+    if (fsq > 0.0) dtf = sqrt(2.0 * xallow / sqrt(fsq));
+    dt = MIN(dtv,dtf);
+    dtsq = dt*dt;
+    delr = sqrt(vsq)*dt + 0.5*sqrt(fsq)*dtsq;
+    if (delr > xallow) dt *= xallow/delr;
+    dtmin = MIN(dtmin,dt);
+  }
+
+  MPI_Allreduce(&dtmin,&dt,1,MPI_DOUBLE,MPI_MIN,world);
+
+  if (minbound) dt = MAX(dt,tmin);
+  if (maxbound) dt = MIN(dt,tmax);
+  if (dt >= BIG) return;
+
+  // if timestep didn't change, just return
+  // else reset update->dt and other classes that depend on it
+  // rRESPA, pair style, fixes
+
+  if (dt == update->dt) return;
+
+  laststep = update->ntimestep;
+
+  update->dt = dt;
+  if (respaflag) update->integrate->reset_dt();
+  if (force->pair) force->pair->reset_dt();
+  for (int i = 0; i < modify->nfix; i++) modify->fix[i]->reset_dt();
+}
+
+/* ---------------------------------------------------------------------- */
+
+double FixDtResetDrude::compute_scalar()
+{
+  return (double) laststep;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixDtResetDrude::pack_forward_comm(int n, int *list, double *buf,
+                                       int pbc_flag, int *pbc)
+{
+  double **v = atom->v, **f = atom->f;
+  int m = 0;
+  for (int i = 0; i < n; i++) {
+    int j = list[i];
+    buf[m++] = v[j][0];
+    buf[m++] = v[j][1];
+    buf[m++] = v[j][2];
+    buf[m++] = f[j][0];
+    buf[m++] = f[j][1];
+    buf[m++] = f[j][2];
+  }
+  return m;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixDtResetDrude::unpack_forward_comm(int n, int first, double *buf)
+{
+  double **v = atom->v, **f = atom->f;
+  int m = 0;
+  int last = first + n;
+  for (int i = first; i < last; i++) {
+    v[i][0] = buf[m++];
+    v[i][1] = buf[m++];
+    v[i][2] = buf[m++];
+    f[i][0] = buf[m++];
+    f[i][1] = buf[m++];
+    f[i][2] = buf[m++];
+  }
+}
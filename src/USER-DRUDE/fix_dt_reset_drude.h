@@ -0,0 +1,76 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(dt/reset/drude,FixDtResetDrude)
+
+#else
+
+#ifndef LMP_FIX_DT_RESET_DRUDE_H
+#define LMP_FIX_DT_RESET_DRUDE_H
+
+#include "fix.h"
+#include "fix_drude.h"
+
+namespace LAMMPS_NS {
+
+class FixDtResetDrude : public Fix {
+ public:
+  FixDtResetDrude(class LAMMPS *, int, char **);
+  ~FixDtResetDrude() {}
+  int setmask();
+  void init();
+  void setup(int);
+  void end_of_step();
+  double compute_scalar();
+  int pack_forward_comm(int, int *, double *, int, int *);
+  void unpack_forward_comm(int, int, double *);
+
+ private:
+  bigint laststep;
+  int minbound,maxbound;
+  double tmin,tmax,xmax;
+  double dlimit;         // core-Drude distance that must not be reached
+  int respaflag;
+  FixDrude *fix_drude;
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Fix dt/reset/drude dlimit requires a minimum timestep
+
+Tmin cannot be NULL with the dlimit keyword, since a core-Drude pair
+beyond dlimit sets the timestep to Tmin.
+
+E: Fix dt/reset/drude requires fix drude
+
+Self-explanatory.
+
+W: Dump dcd/xtc timestamp may be wrong with fix dt/reset/drude
+
+If the fix changes the timestep, the dump dcd file will not
+reflect the change.
+
+*/
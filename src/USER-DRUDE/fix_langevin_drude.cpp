@@ -21,12 +21,15 @@
 #include "input.h"
 #include "variable.h"
 #include "random_mars.h"
+#include "random_philox.h"
 #include "group.h"
 #include "update.h"
+#include "respa.h"
 #include "modify.h"
 #include "compute.h"
 #include "error.h"
 #include "domain.h"
+#include "memory.h"
 
 using namespace LAMMPS_NS;
 using namespace FixConst;
@@ -85,11 +88,10 @@ FixLangevinDrude::FixLangevinDrude(LAMMPS *lmp, int narg, char **arg) :
     error->all(FLERR,"Fix langevin/drude period must be > 0.0");
   if (seed_drude <= 0) error->all(FLERR,"Illegal langevin/drude seed");
 
-  random_core  = new RanMars(lmp,seed_core);
-  random_drude = new RanMars(lmp,seed_drude);
-
   int iarg = 9;
   zero = 0;
+  gjf = 0;
+  counter = 0;
   while (iarg < narg) {
     if (strcmp(arg[iarg],"zero") == 0) {
       if (iarg+2 > narg) error->all(FLERR,"Illegal fix langevin/drude command");
@@ -97,9 +99,40 @@ FixLangevinDrude::FixLangevinDrude(LAMMPS *lmp, int narg, char **arg) :
       else if (strcmp(arg[iarg+1],"yes") == 0) zero = 1;
       else error->all(FLERR,"Illegal fix langevin/drude command");
       iarg += 2;
+    } else if (strcmp(arg[iarg],"rng") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix langevin/drude command");
+      if (strcmp(arg[iarg+1],"mars") == 0) counter = 0;
+      else if (strcmp(arg[iarg+1],"philox") == 0) counter = 1;
+      else error->all(FLERR,"Illegal fix langevin/drude command");
+      iarg += 2;
+    } else if (strcmp(arg[iarg],"gjf") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal fix langevin/drude command");
+      if (strcmp(arg[iarg+1],"no") == 0) gjf = 0;
+      else if (strcmp(arg[iarg+1],"yes") == 0) gjf = 1;
+      else error->all(FLERR,"Illegal fix langevin/drude command");
+      iarg += 2;
     } else error->all(FLERR,"Illegal fix langevin/drude command");
   }
 
+  // in GJF mode this fix is the time integrator of cores and Drudes
+
+  if (gjf) time_integrate = 1;
+  nmax = 0;
+  noise = NULL;
+
+  // counter-based generators are keyed on (seed, timestep, atom tag)
+  // Marsaglia generators have one stream per proc
+
+  random_core = random_drude = NULL;
+  philox_core = philox_drude = NULL;
+  if (counter) {
+    philox_core  = new RanPhilox(seed_core);
+    philox_drude = new RanPhilox(seed_drude);
+  } else {
+    random_core  = new RanMars(lmp,seed_core);
+    random_drude = new RanMars(lmp,seed_drude);
+  }
+
   tflag = 0; // no external compute/temp is specified yet (for bias)
   energy = 0.;
   fix_drude = NULL;
@@ -112,9 +145,12 @@ FixLangevinDrude::FixLangevinDrude(LAMMPS *lmp, int narg, char **arg) :
 FixLangevinDrude::~FixLangevinDrude()
 {
   delete random_core;
+  delete philox_core;
   delete [] tstr_core;
   delete random_drude;
+  delete philox_drude;
   delete [] tstr_drude;
+  memory->destroy(noise);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -122,7 +158,13 @@ FixLangevinDrude::~FixLangevinDrude()
 int FixLangevinDrude::setmask()
 {
   int mask = 0;
-  mask |= POST_FORCE;
+  if (gjf) {
+    mask |= INITIAL_INTEGRATE;
+    mask |= FINAL_INTEGRATE;
+  } else {
+    mask |= POST_FORCE;
+    mask |= POST_FORCE_RESPA;
+  }
   return mask;
 }
 
@@ -153,16 +195,24 @@ void FixLangevinDrude::init()
     if (strcmp(modify->fix[ifix]->style,"drude") == 0) break;
   if (ifix == modify->nfix) error->all(FLERR, "fix langevin/drude requires fix drude");
   fix_drude = (FixDrude *) modify->fix[ifix];
+
+  if (strstr(update->integrate_style,"respa")) {
+    if (gjf)
+      error->all(FLERR,"Fix langevin/drude gjf is not compatible with RESPA");
+    nlevels_respa = ((Respa *) update->integrate)->nlevels;
+  }
+  laststep_respa = -1;
+  substep_respa = 0;
 }
 
 /* ---------------------------------------------------------------------- */
 
 void FixLangevinDrude::setup(int vflag)
 {
-  if (!strstr(update->integrate_style,"verlet"))
-    error->all(FLERR,"RESPA style not compatible with fix langevin/drude");
-  if (!comm->ghost_velocity)
+  if (!gjf && !comm->ghost_velocity)
     error->all(FLERR,"fix langevin/drude requires ghost velocities. Use comm_modify vel yes");
+  if (gjf && temperature)
+    error->all(FLERR,"Fix langevin/drude gjf does not support a temperature bias");
 
   if (zero) {
       int *mask = atom->mask;
@@ -203,30 +253,165 @@ int FixLangevinDrude::modify_param(int narg, char **arg)
   return 0;
 }
 
-/* ---------------------------------------------------------------------- */
+/* ----------------------------------------------------------------------
+   GJF integration (Gronbech-Jensen and Farago) of the centers of mass
+   and of the core-Drude relative coordinates, first half:
+   x(n+1) = x(n) + b dt [v(n) + dt/2m f(n) + xi/2]
+   v      = a [v(n) + dt/2m f(n)] + b xi
+   with a = (1 - dt/2tau) / (1 + dt/2tau), b = 1 / (1 + dt/2tau)
+   and xi the velocity noise of variance 2 kT dt / (m tau)
+------------------------------------------------------------------------- */
 
-void FixLangevinDrude::post_force(int /*vflag*/)
+void FixLangevinDrude::initial_integrate(int /*vflag*/)
 {
-  // Thermalize by adding the langevin force if thermalize=true.
-  // Each core-Drude pair is thermalized only once: where the core is local.
+  if (!fix_drude->partners_local)
+    error->all(FLERR,"Fix langevin/drude gjf requires cores and Drudes "
+               "to be local, use fix drude local yes");
 
-  double **v = atom->v, **f = atom->f;
+  double **x = atom->x, **v = atom->v, **f = atom->f;
   int *mask = atom->mask;
-  int nlocal = atom->nlocal, nall = atom->nlocal + atom->nghost;
+  int nlocal = atom->nlocal;
   int *type = atom->type;
   double *mass = atom->mass;
   double *rmass = atom->rmass;
+  tagint *tag = atom->tag;
   double ftm2v = force->ftm2v, mvv2e = force->mvv2e;
   double kb = force->boltz, dt = update->dt;
+  bigint ntimestep = update->ntimestep;
+  int dim = domain->dimension;
 
   int *drudetype = fix_drude->drudetype;
-  tagint *drudeid = fix_drude->drudeid;
-  double vdrude[3], vcore[3]; // velocities in reduced representation
-  double fdrude[3], fcore[3]; // forces in reduced representation
-  double Ccore, Cdrude, Gcore, Gdrude;
-  double fcoresum[3], fcoreloc[3];
+  int *drude_local = fix_drude->drude_local;
+  double gcore[4], gdrude[4]; // Gaussian random numbers
+  double psumloc[3], psum[3];
+
+  compute_target();
+
+  if (atom->nmax > nmax) {
+    memory->destroy(noise);
+    nmax = atom->nmax;
+    memory->create(noise,nmax,6,"langevin/drude:noise");
+  }
+
+  double ncore_kt  = 2.0 * kb * t_target_core  * dt / t_period_core  / mvv2e;
+  double ndrude_kt = 2.0 * kb * t_target_drude * dt / t_period_drude / mvv2e;
+  double bcore  = 1.0 / (1.0 + 0.5 * dt / t_period_core);
+  double acore  = (1.0 - 0.5 * dt / t_period_core) * bcore;
+  double bdrude = 1.0 / (1.0 + 0.5 * dt / t_period_drude);
+  double adrude = (1.0 - 0.5 * dt / t_period_drude) * bdrude;
+
+  // draw the velocity noise of all centers of mass and Drude oscillators
+  // the net momentum it carries is removed if asked
+
+  for (int k = 0; k < 3; k++) psumloc[k] = psum[k] = 0.;
+  for (int i = 0; i < nlocal; i++) {
+    if (!(mask[i] & groupbit)) continue;
+    if (drudetype[type[i]] == DRUDE_TYPE) continue; // do with the core
+    if (counter) philox_core->gaussian(ntimestep, tag[i], 0, gcore);
+    else for (int k = 0; k < dim; k++) gcore[k] = random_core->gaussian();
+    double mtot = rmass ? rmass[i] : mass[type[i]];
+    if (drudetype[type[i]] == NOPOL_TYPE) {
+      for (int k = 0; k < 3; k++) noise[i][k+3] = 0.;
+    } else {
+      int j = drude_local[i];
+      double mi = mtot, mj = rmass ? rmass[j] : mass[type[j]];
+      mtot = mi + mj;
+      if (counter) philox_drude->gaussian(ntimestep, tag[i], 1, gdrude);
+      else for (int k = 0; k < dim; k++) gdrude[k] = random_drude->gaussian();
+      double sdrude = sqrt(ndrude_kt * mtot / (mi * mj));
+      for (int k = 0; k < dim; k++) noise[i][k+3] = sdrude * gdrude[k];
+    }
+    double score = sqrt(ncore_kt / mtot);
+    for (int k = 0; k < dim; k++) {
+      noise[i][k] = score * gcore[k];
+      if (zero) psumloc[k] += mtot * noise[i][k];
+    }
+    if (dim == 2) noise[i][2] = noise[i][5] = 0.;
+  }
+
+  if (zero) {
+    MPI_Allreduce(psumloc, psum, 3, MPI_DOUBLE, MPI_SUM, world);
+    for (int k = 0; k < dim; k++) psum[k] /= ncore;
+  }
+
+  // update positions and velocities in the reduced representation
+
+  double dtf = 0.5 * dt * ftm2v;
+  for (int i = 0; i < nlocal; i++) {
+    if (!(mask[i] & groupbit)) continue;
+    if (drudetype[type[i]] == DRUDE_TYPE) continue; // do with the core
+    double mi = rmass ? rmass[i] : mass[type[i]];
+    if (drudetype[type[i]] == NOPOL_TYPE) {
+      double dtfm = dtf / mi;
+      for (int k = 0; k < dim; k++) {
+        double xi = noise[i][k] - psum[k] / mi;
+        double vhalf = v[i][k] + dtfm * f[i][k];
+        x[i][k] += bcore * dt * (vhalf + 0.5 * xi);
+        v[i][k] = acore * vhalf + bcore * xi;
+      }
+    } else {
+      int j = drude_local[i];
+      double mj = rmass ? rmass[j] : mass[type[j]];
+      double mtot = mi + mj;
+      double mu = mi * mj / mtot;
+      double ci = mi / mtot, cj = mj / mtot;
+      for (int k = 0; k < dim; k++) {
+        double xi = noise[i][k] - psum[k] / mtot;
+        double vcore = ci * v[i][k] + cj * v[j][k]
+          + dtf / mtot * (f[i][k] + f[j][k]);
+        double vdrude = v[j][k] - v[i][k]
+          + dtf / mu * (ci * f[j][k] - cj * f[i][k]);
+        double dxcore = bcore * dt * (vcore + 0.5 * xi);
+        double dxdrude = bdrude * dt * (vdrude + 0.5 * noise[i][k+3]);
+        vcore = acore * vcore + bcore * xi;
+        vdrude = adrude * vdrude + bdrude * noise[i][k+3];
+        x[i][k] += dxcore - cj * dxdrude;
+        x[j][k] += dxcore + ci * dxdrude;
+        v[i][k] = vcore - cj * vdrude;
+        v[j][k] = vcore + ci * vdrude;
+      }
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   GJF integration, second half: v(n+1) = v + dt/2m f(n+1)
+   this is linear, so it is done on the cores and Drudes directly
+------------------------------------------------------------------------- */
+
+void FixLangevinDrude::final_integrate()
+{
+  double **v = atom->v, **f = atom->f;
+  int *mask = atom->mask;
+  int nlocal = atom->nlocal;
+  int *type = atom->type;
+  double *mass = atom->mass;
+  double *rmass = atom->rmass;
+  double dtf = 0.5 * update->dt * force->ftm2v;
   int dim = domain->dimension;
 
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+
+  for (int i = 0; i < nlocal; i++) {
+    if (!(mask[i] & groupbit)) continue;
+    if (drudetype[type[i]] == DRUDE_TYPE) continue; // do with the core
+    double dtfm = dtf / (rmass ? rmass[i] : mass[type[i]]);
+    for (int k = 0; k < dim; k++) v[i][k] += dtfm * f[i][k];
+    if (drudetype[type[i]] == CORE_TYPE) {
+      int j = drude_local[i];
+      dtfm = dtf / (rmass ? rmass[j] : mass[type[j]]);
+      for (int k = 0; k < dim; k++) v[j][k] += dtfm * f[j][k];
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   set current t_target_core and t_target_drude
+------------------------------------------------------------------------- */
+
+void FixLangevinDrude::compute_target()
+{
   // Compute target core temperature
   if (tstyle_core == CONSTANT)
      t_target_core = t_start_core; // + delta * (t_stop-t_start_core);
@@ -250,19 +435,92 @@ void FixLangevinDrude::post_force(int /*vflag*/)
                           "negative drude temperature");
       modify->addstep_compute(update->ntimestep + nevery);
   }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixLangevinDrude::post_force(int /*vflag*/)
+{
+  thermalize(1,1,update->dt,1);
+}
+
+/* ----------------------------------------------------------------------
+   rRESPA: the Drude relative motion is thermalized at the innermost
+   level, where it is integrated, and the centers of mass at the
+   outermost level
+------------------------------------------------------------------------- */
+
+void FixLangevinDrude::post_force_respa(int /*vflag*/, int ilevel,
+                                        int /*iloop*/)
+{
+  int coreflag = (ilevel == nlevels_respa-1);
+  int drudeflag = (ilevel == 0);
+  if (!coreflag && !drudeflag) return;
+
+  // each inner step of a timestep gets its own random numbers
+
+  if (drudeflag) {
+    if (update->ntimestep != laststep_respa) {
+      laststep_respa = update->ntimestep;
+      substep_respa = 0;
+    } else substep_respa++;
+  }
+
+  thermalize(coreflag,drudeflag,((Respa *) update->integrate)->step[ilevel],
+             1+substep_respa);
+}
+
+/* ----------------------------------------------------------------------
+   add the Langevin forces on the centers of mass (coreflag) and on the
+   relative coordinates of the core-Drude pairs (drudeflag), for a
+   timestep dtl, with the counter-based random numbers of the Drude
+   pairs taken in stream drude_stream
+------------------------------------------------------------------------- */
+
+void FixLangevinDrude::thermalize(int coreflag, int drudeflag, double dtl,
+                                  int drude_stream)
+{
+  // Thermalize by adding the langevin force if thermalize=true.
+  // Each core-Drude pair is thermalized only once: where the core is local.
+
+  double **v = atom->v, **f = atom->f;
+  int *mask = atom->mask;
+  int nlocal = atom->nlocal, nall = atom->nlocal + atom->nghost;
+  int *type = atom->type;
+  double *mass = atom->mass;
+  double *rmass = atom->rmass;
+  double ftm2v = force->ftm2v, mvv2e = force->mvv2e;
+  double kb = force->boltz, dt = dtl;
+
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+  double vdrude[3], vcore[3]; // velocities in reduced representation
+  double fdrude[3], fcore[3]; // forces in reduced representation
+  double Ccore, Cdrude, Gcore, Gdrude;
+  double fcoresum[3], fcoreloc[3];
+  double gcore[4], gdrude[4]; // Gaussian random numbers
+  tagint *tag = atom->tag;
+  bigint ntimestep = update->ntimestep;
+  int dim = domain->dimension;
+
+  compute_target();
 
   // Clear ghost forces
   // They have already been communicated if needed
-  for (int i = nlocal; i < nall; i++) {
-      for (int k = 0; k < dim; k++)
-        f[i][k] = 0.;
+  // No force is added on ghosts if all Drude partners are local
+  if (!fix_drude->partners_local) {
+    for (int i = nlocal; i < nall; i++) {
+        for (int k = 0; k < dim; k++)
+          f[i][k] = 0.;
+    }
   }
-  if (zero) for (int k=0; k<dim; k++) fcoreloc[k] = 0.;
+  if (zero && coreflag) for (int k=0; k<dim; k++) fcoreloc[k] = 0.;
 
   // NB : the masses are the real masses, not the reduced ones
   for (int i = 0; i < nlocal; i++) {
     if (mask[i] & groupbit) { // only the cores need to be in the group
       if (drudetype[type[i]] == NOPOL_TYPE) { // Non-polarizable atom
+        if (!coreflag) continue;
         double mi;
         if (rmass)
           mi = rmass[i];
@@ -271,8 +529,10 @@ void FixLangevinDrude::post_force(int /*vflag*/)
         Gcore  = mi / t_period_core  / ftm2v;
         Ccore  = sqrt(2.0 * Gcore  * kb * t_target_core  / dt / ftm2v / mvv2e);
         if (temperature) temperature->remove_bias(i, v[i]);
+        if (counter) philox_core->gaussian(ntimestep, tag[i], 0, gcore);
+        else for (int k = 0; k < dim; k++) gcore[k] = random_core->gaussian();
         for(int k = 0; k < dim; k++){
-            fcore[k] = Ccore  * random_core->gaussian()  - Gcore  * v[i][k];
+            fcore[k] = Ccore  * gcore[k]  - Gcore  * v[i][k];
             if (zero) fcoreloc[k] += fcore[k];
             f[i][k] += fcore[k];
         }
@@ -280,7 +540,7 @@ void FixLangevinDrude::post_force(int /*vflag*/)
       } else {
         if (drudetype[type[i]] == DRUDE_TYPE) continue; // do with the core
 
-        int j = atom->map(drudeid[i]);
+        int j = drude_local[i];
         double mi, mj, mtot, mu; // i is core, j is drude
         if (rmass) {
           mi = rmass[i];
@@ -303,18 +563,32 @@ void FixLangevinDrude::post_force(int /*vflag*/)
             temperature->remove_bias(i, v[i]);
             temperature->remove_bias(j, v[j]);
         }
+        if (counter) {
+          if (coreflag) philox_core->gaussian(ntimestep, tag[i], 0, gcore);
+          if (drudeflag)
+            philox_drude->gaussian(ntimestep, tag[i], drude_stream, gdrude);
+        } else {
+          if (coreflag)
+            for (int k = 0; k < dim; k++) gcore[k] = random_core->gaussian();
+          if (drudeflag)
+            for (int k = 0; k < dim; k++) gdrude[k] = random_drude->gaussian();
+        }
         for (int k=0; k<dim; k++) {
           // TODO check whether a fix_modify temp can subtract a bias velocity
-          vcore[k] = mi * v[i][k] + mj * v[j][k];
-          vdrude[k] = v[j][k] - v[i][k];
-
-          fcore[k]  = Ccore  * random_core->gaussian()  - Gcore  * vcore[k];
-          fdrude[k] = Cdrude * random_drude->gaussian() - Gdrude * vdrude[k];
-
-          if (zero) fcoreloc[k]  += fcore[k];
+          if (coreflag) {
+            vcore[k] = mi * v[i][k] + mj * v[j][k];
+            fcore[k]  = Ccore  * gcore[k]  - Gcore  * vcore[k];
+            if (zero) fcoreloc[k]  += fcore[k];
+            f[i][k] += mi * fcore[k];
+            f[j][k] += mj * fcore[k];
+          }
 
-          f[i][k] += mi * fcore[k] - fdrude[k];
-          f[j][k] += mj * fcore[k] + fdrude[k];
+          if (drudeflag) {
+            vdrude[k] = v[j][k] - v[i][k];
+            fdrude[k] = Cdrude * gdrude[k] - Gdrude * vdrude[k];
+            f[i][k] -= fdrude[k];
+            f[j][k] += fdrude[k];
+          }
 
           // TODO tally energy if asked
         }
@@ -326,7 +600,7 @@ void FixLangevinDrude::post_force(int /*vflag*/)
     }
   }
 
-  if(zero) { // Remove the drift
+  if (zero && coreflag) { // Remove the drift
     MPI_Allreduce(fcoreloc, fcoresum, dim, MPI_DOUBLE, MPI_SUM, world);
     for (int k=0; k<dim; k++) fcoresum[k] /= ncore;
     for (int i=0; i<nlocal; i++) {
@@ -335,7 +609,7 @@ void FixLangevinDrude::post_force(int /*vflag*/)
           for (int k=0; k<dim; k++) f[i][k] -= fcoresum[k];
         } else {
           if (drudetype[type[i]] == DRUDE_TYPE) continue; // do with the core
-          int j = atom->map(drudeid[i]);
+          int j = drude_local[i];
           double mi, mj, mtot; // i is core, j is drude
           if (rmass) {
             mi = rmass[i];
@@ -357,7 +631,7 @@ void FixLangevinDrude::post_force(int /*vflag*/)
   }
 
   // Reverse communication of the forces on ghost Drude particles
-  comm->reverse_comm();
+  if (!fix_drude->partners_local) comm->reverse_comm();
 }
 
 /* ---------------------------------------------------------------------- */
@@ -32,7 +32,10 @@ class FixLangevinDrude : public Fix {
   int setmask();
   void init();
   void setup(int vflag);
+  virtual void initial_integrate(int);
+  virtual void final_integrate();
   virtual void post_force(int vflag);
+  void post_force_respa(int, int, int);
   void reset_target(double);
   virtual void *extract(const char *, int &);
   int pack_reverse_comm(int, int, double*);
@@ -49,11 +52,22 @@ class FixLangevinDrude : public Fix {
   int tflag;
 
   class RanMars *random_core, *random_drude;
+  class RanPhilox *philox_core, *philox_drude;
+  int counter;          // 1 if counter-based random numbers are used
   int zero;
+  int gjf;              // 1 if GJF integration of COM and relative coords
   bigint ncore;
+  int nmax;
+  double **noise;       // GJF velocity noise of COM and relative coords
   FixDrude * fix_drude;
   class Compute *temperature;
   char *id_temp;
+  int nlevels_respa;
+  bigint laststep_respa;  // timestep and index of the last inner
+  int substep_respa;      // rRESPA step, for the random streams
+
+  void compute_target();
+  void thermalize(int, int, double, int);
 };
 
 }
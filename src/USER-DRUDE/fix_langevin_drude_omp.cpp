@@ -0,0 +1,176 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <math.h>
+#include "fix_langevin_drude_omp.h"
+#include "atom.h"
+#include "force.h"
+#include "comm.h"
+#include "random_philox.h"
+#include "update.h"
+#include "error.h"
+#include "domain.h"
+
+using namespace LAMMPS_NS;
+
+/* ---------------------------------------------------------------------- */
+
+FixLangevinDrudeOMP::FixLangevinDrudeOMP(LAMMPS *lmp, int narg, char **arg) :
+  FixLangevinDrude(lmp, narg, arg)
+{
+  if (!counter && comm->me == 0)
+    error->warning(FLERR,"Fix langevin/drude/omp uses serial random "
+                   "numbers unless rng philox is set");
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixLangevinDrudeOMP::post_force(int vflag)
+{
+  // the Marsaglia streams and the bias removal of a temperature compute
+  // are not thread-safe: fall back to the serial loop in that case
+
+  if (!counter || temperature) {
+    FixLangevinDrude::post_force(vflag);
+    return;
+  }
+
+  double **v = atom->v, **f = atom->f;
+  int *mask = atom->mask;
+  int nlocal = atom->nlocal, nall = atom->nlocal + atom->nghost;
+  int *type = atom->type;
+  double *mass = atom->mass;
+  double *rmass = atom->rmass;
+  double ftm2v = force->ftm2v, mvv2e = force->mvv2e;
+  double kb = force->boltz, dt = update->dt;
+
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+  tagint *tag = atom->tag;
+  bigint ntimestep = update->ntimestep;
+  int dim = domain->dimension;
+  double fcoresum[3], fcoreloc[3];
+  double fx = 0., fy = 0., fz = 0.;
+
+  compute_target();
+
+  // prefactors of the random forces, the friction is divided by the mass
+  double Ccore0  = sqrt(2.0 * kb * t_target_core  / t_period_core
+                        / dt / ftm2v / ftm2v / mvv2e);
+  double Cdrude0 = sqrt(2.0 * kb * t_target_drude / t_period_drude
+                        / dt / ftm2v / ftm2v / mvv2e);
+
+  // Clear ghost forces
+  // They have already been communicated if needed
+  if (!fix_drude->partners_local) {
+    for (int i = nlocal; i < nall; i++)
+      for (int k = 0; k < dim; k++)
+        f[i][k] = 0.;
+  }
+
+  // each pair is handled by the thread owning its core, which is the only
+  // one writing to the (local or ghost) Drude: no force conflicts
+
+  int i;
+#if defined(_OPENMP)
+#pragma omp parallel for private(i) reduction(+:fx,fy,fz) schedule(static)
+#endif
+  for (i = 0; i < nlocal; i++) {
+    if (!(mask[i] & groupbit)) continue; // only the cores need to be in group
+    if (drudetype[type[i]] == DRUDE_TYPE) continue; // do with the core
+
+    double gcore[4], gdrude[4], fcore[3], fdrude[3];
+    philox_core->gaussian(ntimestep, tag[i], 0, gcore);
+
+    if (drudetype[type[i]] == NOPOL_TYPE) { // Non-polarizable atom
+      const double mi = rmass ? rmass[i] : mass[type[i]];
+      const double Gcore = mi / t_period_core / ftm2v;
+      const double Ccore = Ccore0 * sqrt(mi);
+      for (int k = 0; k < dim; k++) {
+        fcore[k] = Ccore * gcore[k] - Gcore * v[i][k];
+        f[i][k] += fcore[k];
+      }
+    } else {
+      const int j = drude_local[i];
+      double mi, mj;
+      if (rmass) {
+        mi = rmass[i];
+        mj = rmass[j];
+      } else {
+        mi = mass[type[i]];
+        mj = mass[type[j]];
+      }
+      const double mtot = mi + mj;
+      const double mu = mi * mj / mtot;
+      mi /= mtot;
+      mj /= mtot;
+
+      const double Gcore  = mtot / t_period_core  / ftm2v;
+      const double Gdrude = mu   / t_period_drude / ftm2v;
+      const double Ccore  = Ccore0  * sqrt(mtot);
+      const double Cdrude = Cdrude0 * sqrt(mu);
+
+      philox_drude->gaussian(ntimestep, tag[i], 1, gdrude);
+      for (int k = 0; k < dim; k++) {
+        const double vcore  = mi * v[i][k] + mj * v[j][k];
+        const double vdrude = v[j][k] - v[i][k];
+        fcore[k]  = Ccore  * gcore[k]  - Gcore  * vcore;
+        fdrude[k] = Cdrude * gdrude[k] - Gdrude * vdrude;
+        f[i][k] += mi * fcore[k] - fdrude[k];
+        f[j][k] += mj * fcore[k] + fdrude[k];
+      }
+    }
+    if (zero) {
+      fx += fcore[0];
+      fy += fcore[1];
+      if (dim == 3) fz += fcore[2];
+    }
+  }
+
+  if (zero) { // Remove the drift
+    fcoreloc[0] = fx;
+    fcoreloc[1] = fy;
+    fcoreloc[2] = fz;
+    MPI_Allreduce(fcoreloc, fcoresum, dim, MPI_DOUBLE, MPI_SUM, world);
+    for (int k = 0; k < dim; k++) fcoresum[k] /= ncore;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(i) schedule(static)
+#endif
+    for (i = 0; i < nlocal; i++) {
+      if (!(mask[i] & groupbit)) continue;
+      if (drudetype[type[i]] == NOPOL_TYPE) {
+        for (int k = 0; k < dim; k++) f[i][k] -= fcoresum[k];
+      } else {
+        if (drudetype[type[i]] == DRUDE_TYPE) continue; // do with the core
+        const int j = drude_local[i];
+        double mi, mj;
+        if (rmass) {
+          mi = rmass[i];
+          mj = rmass[j];
+        } else {
+          mi = mass[type[i]];
+          mj = mass[type[j]];
+        }
+        const double mtot = mi + mj;
+        for (int k = 0; k < dim; k++) {
+          f[i][k] -= mi / mtot * fcoresum[k];
+          f[j][k] -= mj / mtot * fcoresum[k];
+        }
+      }
+    }
+  }
+
+  // Reverse communication of the forces on ghost Drude particles
+  if (!fix_drude->partners_local) comm->reverse_comm();
+}
@@ -0,0 +1,47 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef FIX_CLASS
+
+FixStyle(langevin/drude/omp,FixLangevinDrudeOMP)
+
+#else
+
+#ifndef LMP_FIX_LANGEVIN_DRUDE_OMP_H
+#define LMP_FIX_LANGEVIN_DRUDE_OMP_H
+
+#include "fix_langevin_drude.h"
+
+namespace LAMMPS_NS {
+
+class FixLangevinDrudeOMP : public FixLangevinDrude {
+ public:
+  FixLangevinDrudeOMP(class LAMMPS *, int, char **);
+  virtual ~FixLangevinDrudeOMP() {}
+  virtual void post_force(int vflag);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+W: Fix langevin/drude/omp uses serial random numbers unless rng philox is set
+
+The sequential Marsaglia generator cannot be shared between threads,
+so the thermostat forces are computed by a single thread.  Use the rng
+philox keyword to thread them.
+
+*/
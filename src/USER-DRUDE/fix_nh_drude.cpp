@@ -0,0 +1,417 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "fix_nh_drude.h"
+#include "atom.h"
+#include "force.h"
+#include "comm.h"
+#include "domain.h"
+#include "modify.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+using namespace FixConst;
+
+/* ----------------------------------------------------------------------
+   the last keyword must be "drude Tdrude Tdamp_drude",
+   the arguments before it are those of fix nvt or npt
+------------------------------------------------------------------------- */
+
+FixNHDrude::FixNHDrude(LAMMPS *lmp, int narg, char **arg) :
+  FixNH(lmp, nh_narg(narg, arg), arg)
+{
+  int iarg = nh_narg(narg, arg);
+  if (iarg + 3 != narg)
+    error->all(FLERR,"Illegal fix nvt/drude or npt/drude command");
+  t_drude = force->numeric(FLERR,arg[iarg+1]);
+  t_period_drude = force->numeric(FLERR,arg[iarg+2]);
+  if (t_drude < 0.0 || t_period_drude <= 0.0)
+    error->all(FLERR,"Illegal fix nvt/drude or npt/drude command");
+  t_freq_drude = 1.0 / t_period_drude;
+
+  eta_drude = new double[mtchain];
+  eta_drude_dot = new double[mtchain+1];
+  eta_drude_dotdot = new double[mtchain];
+  eta_drude_mass = new double[mtchain];
+  for (int ich = 0; ich < mtchain; ich++)
+    eta_drude[ich] = eta_drude_dot[ich] = eta_drude_dotdot[ich] = 0.0;
+  eta_drude_dot[mtchain] = 0.0;
+  for (int ich = 0; ich < mtchain; ich++) eta_drude_mass[ich] = 0.0;
+  ke_target_drude = 0.0;
+  factor_eta_drude = 1.0;
+
+  comm_forward = 3;
+  fix_drude = NULL;
+  offset = NULL;
+  nmax = 0;
+  comm_array = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+FixNHDrude::~FixNHDrude()
+{
+  delete [] eta_drude;
+  delete [] eta_drude_dot;
+  delete [] eta_drude_dotdot;
+  delete [] eta_drude_mass;
+  memory->destroy(offset);
+}
+
+/* ----------------------------------------------------------------------
+   number of arguments before the drude keyword
+------------------------------------------------------------------------- */
+
+int FixNHDrude::nh_narg(int narg, char **arg)
+{
+  for (int iarg = 3; iarg < narg; iarg++)
+    if (strcmp(arg[iarg],"drude") == 0) return iarg;
+  return narg;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixNHDrude::init()
+{
+  FixNH::init();
+
+  int ifix;
+  for (ifix = 0; ifix < modify->nfix; ifix++)
+    if (strcmp(modify->fix[ifix]->style,"drude") == 0) break;
+  if (ifix == modify->nfix)
+    error->all(FLERR,"Fix nvt/drude or npt/drude requires fix drude");
+  fix_drude = (FixDrude *) modify->fix[ifix];
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixNHDrude::setup(int vflag)
+{
+  FixNH::setup(vflag);
+
+  // degrees of freedom of the relative core-Drude motion
+
+  int nlocal = atom->nlocal;
+  int *mask = atom->mask;
+  int *type = atom->type;
+  int *drudetype = fix_drude->drudetype;
+  bigint dof_drude_loc = 0;
+  for (int i = 0; i < nlocal; i++)
+    if (mask[i] & groupbit && drudetype[type[i]] == DRUDE_TYPE)
+      dof_drude_loc++;
+  dof_drude_loc *= domain->dimension;
+  MPI_Allreduce(&dof_drude_loc,&dof_drude,1,MPI_LMP_BIGINT,MPI_SUM,world);
+
+  ke_target_drude = dof_drude * boltz * t_drude;
+  eta_drude_mass[0] = ke_target_drude / (t_freq_drude*t_freq_drude);
+  for (int ich = 1; ich < mtchain; ich++)
+    eta_drude_mass[ich] = boltz * t_drude / (t_freq_drude*t_freq_drude);
+  for (int ich = 1; ich < mtchain; ich++)
+    eta_drude_dotdot[ich] = (eta_drude_mass[ich-1]*eta_drude_dot[ich-1]*
+                             eta_drude_dot[ich-1] - boltz * t_drude) /
+      eta_drude_mass[ich];
+}
+
+/* ----------------------------------------------------------------------
+   update ghost copies of x or v when some Drude partners are ghosts
+------------------------------------------------------------------------- */
+
+void FixNHDrude::comm_partners(double **array)
+{
+  if (fix_drude->partners_local) return;
+  comm_array = array;
+  comm->forward_comm_fix(this);
+}
+
+/* ---------------------------------------------------------------------- */
+
+int FixNHDrude::pack_forward_comm(int n, int *list, double *buf,
+                                  int pbc_flag, int *pbc)
+{
+  double dx = 0.0, dy = 0.0, dz = 0.0;
+  if (comm_array == atom->x && pbc_flag) {
+    dx = pbc[0]*domain->xprd;
+    dy = pbc[1]*domain->yprd;
+    dz = pbc[2]*domain->zprd;
+    if (domain->triclinic) {
+      dx += pbc[5]*domain->xy + pbc[4]*domain->xz;
+      dy += pbc[3]*domain->yz;
+    }
+  }
+
+  int m = 0;
+  for (int i = 0; i < n; i++) {
+    int j = list[i];
+    buf[m++] = comm_array[j][0] + dx;
+    buf[m++] = comm_array[j][1] + dy;
+    buf[m++] = comm_array[j][2] + dz;
+  }
+  return m;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixNHDrude::unpack_forward_comm(int n, int first, double *buf)
+{
+  int m = 0;
+  int last = first + n;
+  for (int i = first; i < last; i++) {
+    comm_array[i][0] = buf[m++];
+    comm_array[i][1] = buf[m++];
+    comm_array[i][2] = buf[m++];
+  }
+}
+
+/* ----------------------------------------------------------------------
+   offset of each atom of a core-Drude pair from the center of mass
+   of the pair, for positions or velocities.
+   The pair is seen the same way on the procs of the core and the Drude.
+------------------------------------------------------------------------- */
+
+void FixNHDrude::compute_offsets(double **a)
+{
+  int nlocal = atom->nlocal;
+  int *mask = atom->mask;
+  int *type = atom->type;
+  double *rmass = atom->rmass, *mass = atom->mass;
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+
+  if (atom->nmax > nmax) {
+    memory->destroy(offset);
+    nmax = atom->nmax;
+    memory->create(offset,nmax,3,"nh/drude:offset");
+  }
+
+  for (int i = 0; i < nlocal; i++) {
+    offset[i][0] = offset[i][1] = offset[i][2] = 0.0;
+    if (!(mask[i] & groupbit) || drudetype[type[i]] == NOPOL_TYPE) continue;
+    int j = drude_local[i];
+    if (j < 0) error->one(FLERR,"Drude partner not found");
+    if (!(mask[j] & groupbit)) continue;
+    double mi, mj;
+    if (rmass) {
+      mi = rmass[i];
+      mj = rmass[j];
+    } else {
+      mi = mass[type[i]];
+      mj = mass[type[j]];
+    }
+    double coeff = mj / (mi + mj);
+    for (int k = 0; k < 3; k++) offset[i][k] = coeff * (a[i][k] - a[j][k]);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void FixNHDrude::add_offsets(double **a, double scale)
+{
+  int nlocal = atom->nlocal;
+  for (int i = 0; i < nlocal; i++)
+    for (int k = 0; k < 3; k++) a[i][k] += scale * offset[i][k];
+}
+
+/* ----------------------------------------------------------------------
+   dilate the centers of mass of the core-Drude pairs,
+   not the core-Drude distances
+------------------------------------------------------------------------- */
+
+void FixNHDrude::remap()
+{
+  double **x = atom->x;
+  comm_partners(x);
+  compute_offsets(x);
+  add_offsets(x, -1.0);
+  FixNH::remap();
+  add_offsets(x, 1.0);
+}
+
+/* ----------------------------------------------------------------------
+   barostat acts on the velocities of the centers of mass only
+------------------------------------------------------------------------- */
+
+void FixNHDrude::nh_v_press()
+{
+  double **v = atom->v;
+  comm_partners(v);
+  compute_offsets(v);
+  add_offsets(v, -1.0);
+  FixNH::nh_v_press();
+  add_offsets(v, 1.0);
+}
+
+/* ----------------------------------------------------------------------
+   thermostat the centers of mass with the chain of FixNH
+   and the relative core-Drude motion with the Drude chain
+------------------------------------------------------------------------- */
+
+void FixNHDrude::nh_v_temp()
+{
+  double **v = atom->v;
+  int nlocal = atom->nlocal;
+  int *type = atom->type;
+  double *rmass = atom->rmass, *mass = atom->mass;
+
+  comm_partners(v);
+  compute_offsets(v);
+
+  // twice the kinetic energy of the relative motion
+
+  double ke_loc = 0.0, kecurrent;
+  for (int i = 0; i < nlocal; i++) {
+    double mi = rmass ? rmass[i] : mass[type[i]];
+    ke_loc += mi * (offset[i][0]*offset[i][0] + offset[i][1]*offset[i][1] +
+                    offset[i][2]*offset[i][2]);
+  }
+  MPI_Allreduce(&ke_loc,&kecurrent,1,MPI_DOUBLE,MPI_SUM,world);
+  kecurrent *= force->mvv2e;
+
+  nhc_drude_integrate_begin(kecurrent);
+
+  add_offsets(v, -1.0);
+  FixNH::nh_v_temp();
+  add_offsets(v, factor_eta_drude);
+
+  nhc_drude_integrate_end(kecurrent * factor_eta_drude * factor_eta_drude);
+}
+
+/* ----------------------------------------------------------------------
+   first half of one sub-step of the Drude Nose-Hoover chain,
+   sets the scaling factor of the relative velocities
+------------------------------------------------------------------------- */
+
+void FixNHDrude::nhc_drude_integrate_begin(double kecurrent)
+{
+  double expfac;
+  double ncfac = 1.0/nc_tchain;
+
+  if (eta_drude_mass[0] > 0.0)
+    eta_drude_dotdot[0] = (kecurrent - ke_target_drude)/eta_drude_mass[0];
+  else eta_drude_dotdot[0] = 0.0;
+
+  for (int ich = mtchain-1; ich > 0; ich--) {
+    expfac = exp(-ncfac*dt8*eta_drude_dot[ich+1]);
+    eta_drude_dot[ich] *= expfac;
+    eta_drude_dot[ich] += eta_drude_dotdot[ich] * ncfac*dt4;
+    eta_drude_dot[ich] *= tdrag_factor;
+    eta_drude_dot[ich] *= expfac;
+  }
+
+  expfac = exp(-ncfac*dt8*eta_drude_dot[1]);
+  eta_drude_dot[0] *= expfac;
+  eta_drude_dot[0] += eta_drude_dotdot[0] * ncfac*dt4;
+  eta_drude_dot[0] *= tdrag_factor;
+  eta_drude_dot[0] *= expfac;
+
+  factor_eta_drude = exp(-ncfac*dthalf*eta_drude_dot[0]);
+}
+
+/* ----------------------------------------------------------------------
+   second half of one sub-step of the Drude Nose-Hoover chain
+------------------------------------------------------------------------- */
+
+void FixNHDrude::nhc_drude_integrate_end(double kecurrent)
+{
+  double expfac;
+  double ncfac = 1.0/nc_tchain;
+
+  if (eta_drude_mass[0] > 0.0)
+    eta_drude_dotdot[0] = (kecurrent - ke_target_drude)/eta_drude_mass[0];
+  else eta_drude_dotdot[0] = 0.0;
+
+  for (int ich = 0; ich < mtchain; ich++)
+    eta_drude[ich] += ncfac*dthalf*eta_drude_dot[ich];
+
+  expfac = exp(-ncfac*dt8*eta_drude_dot[1]);
+  eta_drude_dot[0] *= expfac;
+  eta_drude_dot[0] += eta_drude_dotdot[0] * ncfac*dt4;
+  eta_drude_dot[0] *= expfac;
+
+  for (int ich = 1; ich < mtchain; ich++) {
+    expfac = exp(-ncfac*dt8*eta_drude_dot[ich+1]);
+    eta_drude_dot[ich] *= expfac;
+    eta_drude_dotdot[ich] = (eta_drude_mass[ich-1]*eta_drude_dot[ich-1]*
+                             eta_drude_dot[ich-1] - boltz * t_drude) /
+      eta_drude_mass[ich];
+    eta_drude_dot[ich] += eta_drude_dotdot[ich] * ncfac*dt4;
+    eta_drude_dot[ich] *= expfac;
+  }
+}
+
+/* ----------------------------------------------------------------------
+   add the energy of the Drude chain to the conserved quantity
+------------------------------------------------------------------------- */
+
+double FixNHDrude::compute_scalar()
+{
+  double energy = FixNH::compute_scalar();
+  double kt = boltz * t_drude;
+
+  energy += ke_target_drude * eta_drude[0] +
+    0.5*eta_drude_mass[0]*eta_drude_dot[0]*eta_drude_dot[0];
+  for (int ich = 1; ich < mtchain; ich++)
+    energy += kt * eta_drude[ich] +
+      0.5*eta_drude_mass[ich]*eta_drude_dot[ich]*eta_drude_dot[ich];
+
+  return energy;
+}
+
+/* ----------------------------------------------------------------------
+   the Drude chain is written before the data of FixNH:
+   mtchain, eta_drude[mtchain], eta_drude_dot[mtchain]
+------------------------------------------------------------------------- */
+
+void FixNHDrude::write_restart(FILE *fp)
+{
+  int ndrude = 1 + 2*mtchain;
+  int nsize = ndrude + size_restart_global();
+  double *list;
+  memory->create(list,nsize,"nh/drude:list");
+
+  list[0] = mtchain;
+  for (int ich = 0; ich < mtchain; ich++) {
+    list[1+ich] = eta_drude[ich];
+    list[1+mtchain+ich] = eta_drude_dot[ich];
+  }
+  pack_restart_data(&list[ndrude]);
+
+  if (comm->me == 0) {
+    int size = nsize * sizeof(double);
+    fwrite(&size,sizeof(int),1,fp);
+    fwrite(list,sizeof(double),nsize,fp);
+  }
+  memory->destroy(list);
+}
+
+/* ----------------------------------------------------------------------
+   use state info from restart file to restart the Fix,
+   the Drude chain is restored only if its length is unchanged
+------------------------------------------------------------------------- */
+
+void FixNHDrude::restart(char *buf)
+{
+  double *list = (double *) buf;
+  int mtchain_prev = static_cast<int> (list[0]);
+  if (mtchain_prev == mtchain) {
+    for (int ich = 0; ich < mtchain; ich++) {
+      eta_drude[ich] = list[1+ich];
+      eta_drude_dot[ich] = list[1+mtchain+ich];
+    }
+  }
+  FixNH::restart((char *) &list[1+2*mtchain_prev]);
+}
@@ -0,0 +1,73 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifndef LMP_FIX_NH_DRUDE_H
+#define LMP_FIX_NH_DRUDE_H
+
+#include "fix_nh.h"
+#include "fix_drude.h"
+
+namespace LAMMPS_NS {
+
+class FixNHDrude : public FixNH {
+ public:
+  FixNHDrude(class LAMMPS *, int, char **);
+  virtual ~FixNHDrude();
+  virtual void init();
+  virtual void setup(int);
+  virtual double compute_scalar();
+  virtual void write_restart(FILE *);
+  virtual void restart(char *);
+  int pack_forward_comm(int, int *, double *, int, int *);
+  void unpack_forward_comm(int, int, double *);
+
+ protected:
+  double t_drude, t_period_drude, t_freq_drude;
+  double ke_target_drude;
+  bigint dof_drude;
+  double *eta_drude, *eta_drude_dot, *eta_drude_dotdot, *eta_drude_mass;
+  double factor_eta_drude;
+
+  FixDrude *fix_drude;
+  double **offset;         // offset of each atom from the center of mass
+  int nmax;
+  double **comm_array;     // x or v for forward communication
+
+  static int nh_narg(int, char **);
+  void comm_partners(double **);
+  void compute_offsets(double **);
+  void add_offsets(double **, double);
+  void nhc_drude_integrate_begin(double);
+  void nhc_drude_integrate_end(double);
+
+  virtual void remap();
+  virtual void nh_v_press();
+  virtual void nh_v_temp();
+};
+
+}
+
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal fix nvt/drude or npt/drude command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.
+
+E: Fix nvt/drude or npt/drude requires fix drude
+
+Self-explanatory.
+
+*/
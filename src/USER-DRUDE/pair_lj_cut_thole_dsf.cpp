@@ -0,0 +1,280 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Damped shifted force Coulomb (Fennell and Gezelter) with the Thole
+   screening of lj/cut/thole/long, for runs without KSpace
+------------------------------------------------------------------------- */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pair_lj_cut_thole_dsf.h"
+#include "atom.h"
+#include "comm.h"
+#include "force.h"
+#include "neighbor.h"
+#include "neigh_list.h"
+#include "modify.h"
+#include "math_const.h"
+#include "memory.h"
+#include "error.h"
+#include "thole_table.h"
+
+using namespace LAMMPS_NS;
+using namespace MathConst;
+
+#define EWALD_P   0.3275911
+#define A1        0.254829592
+#define A2       -0.284496736
+#define A3        1.421413741
+#define A4       -1.453152027
+#define A5        1.061405429
+
+/* ---------------------------------------------------------------------- */
+
+PairLJCutTholeDSF::PairLJCutTholeDSF(LAMMPS *lmp) : PairLJCutTholeLong(lmp)
+{
+  ewaldflag = pppmflag = 0;
+  respa_enable = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairLJCutTholeDSF::compute(int eflag, int vflag)
+{
+  int i,j,ii,jj,inum,jnum,itype,jtype;
+  double qtmp,xtmp,ytmp,ztmp,delx,dely,delz,evdwl,ecoul,fpair;
+  double r,rsq,r2inv,r6inv,forcecoul,forcelj,factor_coul,factor_lj;
+  double prefactor,erfcc,erfcd,t;
+  int *ilist,*jlist,*numneigh,**firstneigh;
+  double ethole;
+
+  evdwl = ecoul = 0.0;
+  if (eflag || vflag) ev_setup(eflag,vflag);
+  else evflag = vflag_fdotr = 0;
+
+  double **x = atom->x;
+  double **f = atom->f;
+  double *q = atom->q;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  double *special_coul = force->special_coul;
+  double *special_lj = force->special_lj;
+  int newton_pair = force->newton_pair;
+  double qqrd2e = force->qqrd2e;
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+
+  inum = list->inum;
+  ilist = list->ilist;
+  numneigh = list->numneigh;
+  firstneigh = list->firstneigh;
+
+  // loop over neighbors of my atoms
+
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    qtmp = q[i];
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    itype = type[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    if (drudetype[itype] != NOPOL_TYPE && drude_local[i] < 0)
+      error->one(FLERR, "Drude partner not found");
+
+    if (eflag) {
+      double e_self = -(e_shift/2.0 + alpha/MY_PIS) * qtmp*qtmp*qqrd2e;
+      ev_tally(i,i,nlocal,0,0.0,e_self,0.0,0.0,0.0,0.0);
+    }
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj];
+      factor_lj = special_lj[sbmask(j)];
+      factor_coul = special_coul[sbmask(j)];
+      j &= NEIGHMASK;
+
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+      jtype = type[j];
+
+      if (rsq < cutsq[itype][jtype]) {
+        r2inv = 1.0/rsq;
+
+        if (rsq < cut_coulsq) {
+          r = sqrt(rsq);
+          prefactor = factor_coul * qqrd2e*qtmp*q[j]/r;
+          erfcd = exp(-alpha*alpha*rsq);
+          t = 1.0 / (1.0 + EWALD_P*alpha*r);
+          erfcc = t * (A1+t*(A2+t*(A3+t*(A4+t*A5)))) * erfcd;
+          forcecoul = prefactor * (erfcc/r + 2.0*alpha/MY_PIS * erfcd +
+                                   r*f_shift) * r;
+
+          // Thole screening of the Drude charges, as in lj/cut/thole/long
+
+          forcecoul += thole_force(i,j,itype,jtype,r,factor_coul,ethole);
+        } else forcecoul = 0.0;
+
+        if (rsq < cut_ljsq[itype][jtype]) {
+          r6inv = r2inv*r2inv*r2inv;
+          forcelj = r6inv * (lj1[itype][jtype]*r6inv - lj2[itype][jtype]);
+        } else forcelj = 0.0;
+
+        fpair = (forcecoul + factor_lj*forcelj) * r2inv;
+
+        f[i][0] += delx*fpair;
+        f[i][1] += dely*fpair;
+        f[i][2] += delz*fpair;
+        if (newton_pair || j < nlocal) {
+          f[j][0] -= delx*fpair;
+          f[j][1] -= dely*fpair;
+          f[j][2] -= delz*fpair;
+        }
+
+        if (eflag) {
+          if (rsq < cut_coulsq) {
+            ecoul = prefactor * (erfcc - r*e_shift - rsq*f_shift);
+            ecoul += ethole;
+          } else ecoul = 0.0;
+
+          if (rsq < cut_ljsq[itype][jtype]) {
+            evdwl = r6inv*(lj3[itype][jtype]*r6inv-lj4[itype][jtype]) -
+              offset[itype][jtype];
+            evdwl *= factor_lj;
+          } else evdwl = 0.0;
+        }
+
+        if (evflag) ev_tally(i,j,nlocal,newton_pair,
+                             evdwl,ecoul,fpair,delx,dely,delz);
+      }
+    }
+  }
+
+  if (vflag_fdotr) virial_fdotr_compute();
+}
+
+/* ----------------------------------------------------------------------
+   global settings: damp alpha cutoff (cutoff2 (cutoff3))
+   everything but alpha is handled as in lj/cut/thole/long
+------------------------------------------------------------------------- */
+
+void PairLJCutTholeDSF::settings(int narg, char **arg)
+{
+  if (narg < 3 || narg > 5) error->all(FLERR,"Illegal pair_style command");
+
+  alpha = force->numeric(FLERR,arg[1]);
+
+  char **largs = new char*[narg-1];
+  largs[0] = arg[0];
+  for (int iarg = 2; iarg < narg; iarg++) largs[iarg-1] = arg[iarg];
+  PairLJCutTholeLong::settings(narg-1,largs);
+  delete [] largs;
+}
+
+/* ----------------------------------------------------------------------
+   init specific to this pair style
+------------------------------------------------------------------------- */
+
+void PairLJCutTholeDSF::init_style()
+{
+  if (!atom->q_flag)
+    error->all(FLERR,"Pair style lj/cut/thole/dsf requires atom attribute q");
+  int ifix;
+  for (ifix = 0; ifix < modify->nfix; ifix++)
+    if (strcmp(modify->fix[ifix]->style,"drude") == 0) break;
+  if (ifix == modify->nfix)
+      error->all(FLERR, "Pair style lj/cut/thole/dsf requires fix drude");
+  fix_drude = (FixDrude *) modify->fix[ifix];
+
+  neighbor->request(this,instance_me);
+
+  cut_coulsq = cut_coul * cut_coul;
+  cut_respa = NULL;
+
+  double erfcc = erfc(alpha*cut_coul);
+  double erfcd = exp(-alpha*alpha*cut_coul*cut_coul);
+  f_shift = -(erfcc/cut_coulsq + 2.0/MY_PIS*alpha*erfcd/cut_coul);
+  e_shift = erfcc/cut_coul - f_shift*cut_coul;
+
+  tholetable->init(tholetablebits);
+}
+
+/* ----------------------------------------------------------------------
+  proc 0 writes to restart file
+------------------------------------------------------------------------- */
+
+void PairLJCutTholeDSF::write_restart_settings(FILE *fp)
+{
+  PairLJCutTholeLong::write_restart_settings(fp);
+  fwrite(&alpha,sizeof(double),1,fp);
+}
+
+/* ----------------------------------------------------------------------
+  proc 0 reads from restart file, bcasts
+------------------------------------------------------------------------- */
+
+void PairLJCutTholeDSF::read_restart_settings(FILE *fp)
+{
+  PairLJCutTholeLong::read_restart_settings(fp);
+  if (comm->me == 0) fread(&alpha,sizeof(double),1,fp);
+  MPI_Bcast(&alpha,1,MPI_DOUBLE,0,world);
+}
+
+/* ---------------------------------------------------------------------- */
+
+double PairLJCutTholeDSF::single(int i, int j, int itype, int jtype,
+                                 double rsq, double factor_coul,
+                                 double factor_lj, double &fforce)
+{
+  double r2inv,r6inv,r,prefactor,erfcc,erfcd,t;
+  double forcecoul,forcelj,phicoul,philj,ethole;
+
+  r2inv = 1.0/rsq;
+  if (rsq < cut_coulsq) {
+    r = sqrt(rsq);
+    prefactor = factor_coul * force->qqrd2e * atom->q[i]*atom->q[j]/r;
+    erfcd = exp(-alpha*alpha*rsq);
+    t = 1.0 / (1.0 + EWALD_P*alpha*r);
+    erfcc = t * (A1+t*(A2+t*(A3+t*(A4+t*A5)))) * erfcd;
+    forcecoul = prefactor * (erfcc/r + 2.0*alpha/MY_PIS * erfcd +
+                             r*f_shift) * r;
+    forcecoul += thole_force(i,j,itype,jtype,r,factor_coul,ethole);
+  } else forcecoul = 0.0;
+
+  if (rsq < cut_ljsq[itype][jtype]) {
+    r6inv = r2inv*r2inv*r2inv;
+    forcelj = r6inv * (lj1[itype][jtype]*r6inv - lj2[itype][jtype]);
+  } else forcelj = 0.0;
+
+  fforce = (forcecoul + factor_lj*forcelj) * r2inv;
+
+  double eng = 0.0;
+  if (rsq < cut_coulsq) {
+    phicoul = prefactor * (erfcc - r*e_shift - rsq*f_shift);
+    eng += phicoul + ethole;
+  }
+
+  if (rsq < cut_ljsq[itype][jtype]) {
+    philj = r6inv*(lj3[itype][jtype]*r6inv-lj4[itype][jtype]) -
+      offset[itype][jtype];
+    eng += factor_lj*philj;
+  }
+
+  return eng;
+}
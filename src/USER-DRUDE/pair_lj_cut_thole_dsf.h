@@ -0,0 +1,70 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef PAIR_CLASS
+
+PairStyle(lj/cut/thole/dsf,PairLJCutTholeDSF)
+
+#else
+
+#ifndef LMP_PAIR_LJ_CUT_THOLE_DSF_H
+#define LMP_PAIR_LJ_CUT_THOLE_DSF_H
+
+#include "pair_lj_cut_thole_long.h"
+
+namespace LAMMPS_NS {
+
+class PairLJCutTholeDSF : public PairLJCutTholeLong {
+
+ public:
+  PairLJCutTholeDSF(class LAMMPS *);
+  virtual ~PairLJCutTholeDSF() {}
+  virtual void compute(int, int);
+  virtual void settings(int, char **);
+  virtual void init_style();
+  virtual void write_restart_settings(FILE *);
+  virtual void read_restart_settings(FILE *);
+  virtual double single(int, int, int, int, double, double, double, double &);
+
+ protected:
+  double alpha;
+  double e_shift,f_shift;
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Illegal ... command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.  You can use -echo screen as a
+command-line option when running LAMMPS to see the offending line.
+
+E: Pair style lj/cut/thole/dsf requires atom attribute q
+
+The atom style defined does not have this attribute.
+
+E: Pair style lj/cut/thole/dsf requires fix drude
+
+Self-explanatory.
+
+E: Drude partner not found
+
+The Drude partner of a polarizable atom is neither a local nor a
+ghost atom.  The communication cutoff may be too short.
+
+*/
@@ -0,0 +1,51 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef PAIR_CLASS
+
+PairStyle(lj/cut/thole/dsf/omp,PairLJCutTholeDSFOMP)
+
+#else
+
+#ifndef LMP_PAIR_LJ_CUT_THOLE_DSF_OMP_H
+#define LMP_PAIR_LJ_CUT_THOLE_DSF_OMP_H
+
+#include "pair_lj_cut_thole_dsf.h"
+#include "thr_omp.h"
+
+namespace LAMMPS_NS {
+
+class PairLJCutTholeDSFOMP : public PairLJCutTholeDSF, public ThrOMP {
+
+ public:
+  PairLJCutTholeDSFOMP(class LAMMPS *);
+  virtual void compute(int, int);
+
+ private:
+  template <int EVFLAG, int EFLAG, int NEWTON_PAIR>
+      void eval(int ifrom, int ito, ThrData * const thr);
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Drude partner not found
+
+The Drude partner of a polarizable atom is neither a local nor a
+ghost atom.  The communication cutoff may be too short.
+
+*/
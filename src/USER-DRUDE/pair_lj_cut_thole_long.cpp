@@ -26,12 +26,14 @@
 #include "kspace.h"
 #include "update.h"
 #include "integrate.h"
+#include "respa.h"
 #include "neighbor.h"
 #include "neigh_list.h"
 #include "neigh_request.h"
 #include "math_const.h"
 #include "memory.h"
 #include "error.h"
+#include "thole_table.h"
 
 using namespace LAMMPS_NS;
 using namespace MathConst;
@@ -45,15 +47,40 @@ using namespace MathConst;
 #define B4       -5.80844129e-3
 #define B5        1.14652755e-1
 
+// relative accuracy of the Thole damping at the default Thole cutoff
+
+#define THOLE_ACC 1.0e-5
+
+/* ----------------------------------------------------------------------
+   smallest x = ascreen*r beyond which the damping of the force,
+   exp(-x) (1 + x + x^2/2), is below THOLE_ACC
+------------------------------------------------------------------------- */
+
+static double thole_range()
+{
+  double x = 1.0;
+  for (int iter = 0; iter < 50; iter++) {
+    double g = exp(-x) * (1.0 + x + 0.5*x*x);
+    double dg = -0.5 * x*x * exp(-x);
+    double dx = (log(g) - log(THOLE_ACC)) / (dg/g);
+    x -= dx;
+    if (fabs(dx) < 1.0e-8) break;
+  }
+  return x;
+}
+
 /* ---------------------------------------------------------------------- */
 
 PairLJCutTholeLong::PairLJCutTholeLong(LAMMPS *lmp) : Pair(lmp)
 {
   ewaldflag = pppmflag = 1;
+  respa_enable = 1;
   writedata = 1;
   ftable = NULL;
   qdist = 0.0;
   fix_drude = NULL;
+  tholetablebits = 0;
+  tholetable = new TholeTable(lmp);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -66,6 +93,8 @@ PairLJCutTholeLong::~PairLJCutTholeLong()
     memory->destroy(polar);
     memory->destroy(thole);
     memory->destroy(ascreen);
+    memory->destroy(cut_thole);
+    memory->destroy(cut_tholesq);
     memory->destroy(cut_lj);
     memory->destroy(cut_ljsq);
     memory->destroy(scale);
@@ -78,6 +107,7 @@ PairLJCutTholeLong::~PairLJCutTholeLong()
     memory->destroy(offset);
   }
   if (ftable) free_tables();
+  delete tholetable;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -91,9 +121,8 @@ void PairLJCutTholeLong::compute(int eflag, int vflag)
   double grij,expm2,prefactor,t,erfc,u;
   int *ilist,*jlist,*numneigh,**firstneigh;
   double factor_f,factor_e;
-  int di,dj;
-  double dqi,dqj,dcoul,asr,exp_asr;
-  int di_closest;
+  double dqi,dqj,dcoul,asr,exp_asr,damp_f,damp_e;
+  int di_closest,tholeflag;
 
   evdwl = ecoul = 0.0;
   if (eflag || vflag) ev_setup(eflag,vflag);
@@ -109,7 +138,8 @@ void PairLJCutTholeLong::compute(int eflag, int vflag)
   int newton_pair = force->newton_pair;
   double qqrd2e = force->qqrd2e;
   int *drudetype = fix_drude->drudetype;
-  tagint *drudeid = fix_drude->drudeid;
+  int *drude_local = fix_drude->drude_local;
+  double *drude_dq = fix_drude->drude_dq;
 
   inum = list->inum;
   ilist = list->ilist;
@@ -128,13 +158,9 @@ void PairLJCutTholeLong::compute(int eflag, int vflag)
     jnum = numneigh[i];
 
     if (drudetype[type[i]] != NOPOL_TYPE){
-      di = atom->map(drudeid[i]);
-      if (di < 0) error->all(FLERR, "Drude partner not found");
-      di_closest = domain->closest_image(i, di);
-      if (drudetype[type[i]] == CORE_TYPE)
-        dqi = -q[di];
-      else
-        dqi = qi;
+      di_closest = drude_local[i];
+      if (di_closest < 0) error->one(FLERR, "Drude partner not found");
+      dqi = drude_dq[i];
     }
 
     for (jj = 0; jj < jnum; jj++) {
@@ -180,20 +206,33 @@ void PairLJCutTholeLong::compute(int eflag, int vflag)
             }
           }
 
+          // beyond the Thole cutoff only the exclusion of the
+          // Drude charges remains, for special pairs
+
+          tholeflag = 0;
           if (drudetype[type[i]] != NOPOL_TYPE &&
-              drudetype[type[j]] != NOPOL_TYPE){
-            if (j != di_closest){
-              if (drudetype[type[j]] == CORE_TYPE){
-                dj = atom->map(drudeid[j]);
-                dqj = -q[dj];
-              } else dqj = qj;
-              asr = ascreen[type[i]][type[j]] * r;
-              exp_asr = exp(-asr);
+              drudetype[type[j]] != NOPOL_TYPE && j != di_closest) {
+            if (rsq < cut_tholesq[itype][jtype]) {
+              asr = ascreen[itype][jtype] * r;
+              if (!tholetablebits || asr*asr <= tholetable->innersq) {
+                exp_asr = exp(-asr);
+                factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr))))
+                    - factor_coul;
+                if (eflag) factor_e = 0.5*(2. - (exp_asr * (2. + asr)))
+                               - factor_coul;
+              } else {
+                tholetable->lookup(asr*asr,damp_f,damp_e,eflag);
+                factor_f = 1.0 - damp_f - factor_coul;
+                if (eflag) factor_e = 1.0 - damp_e - factor_coul;
+              }
+              tholeflag = 1;
+            } else if (factor_coul < 1.0) {
+              factor_f = factor_e = 1.0 - factor_coul;
+              tholeflag = 1;
+            }
+            if (tholeflag) {
+              dqj = drude_dq[j];
               dcoul = qqrd2e * dqi * dqj / r;
-              factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr))))
-                  - factor_coul;
-              if (eflag) factor_e = 0.5*(2. - (exp_asr * (2. + asr)))
-                             - factor_coul;
               forcecoul += factor_f * dcoul;
             }
           }
@@ -224,10 +263,7 @@ void PairLJCutTholeLong::compute(int eflag, int vflag)
               ecoul = qi*qj * table;
             }
             if (factor_coul < 1.0) ecoul -= (1.0-factor_coul)*prefactor;
-            if (drudetype[type[i]] != NOPOL_TYPE &&
-                drudetype[type[j]] != NOPOL_TYPE && j != di_closest){
-              ecoul += factor_e * dcoul;
-            }
+            if (tholeflag) ecoul += factor_e * dcoul;
           } else ecoul = 0.0;
 
           if (rsq < cut_ljsq[itype][jtype]) {
@@ -246,6 +282,413 @@ void PairLJCutTholeLong::compute(int eflag, int vflag)
   if (vflag_fdotr) virial_fdotr_compute();
 }
 
+/* ----------------------------------------------------------------------
+   Thole correction to forcecoul between the Drude charges of i and j,
+   and the corresponding energy in ethole, 0 if not both polarizable
+------------------------------------------------------------------------- */
+
+double PairLJCutTholeLong::thole_force(int i, int j, int itype, int jtype,
+                                       double r, double factor_coul,
+                                       double &ethole)
+{
+  double asr,exp_asr,damp_f,damp_e,factor_f,factor_e,dcoul;
+
+  int *type = atom->type;
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+  double *drude_dq = fix_drude->drude_dq;
+
+  ethole = 0.0;
+  if (drudetype[type[i]] == NOPOL_TYPE || drudetype[type[j]] == NOPOL_TYPE ||
+      j == drude_local[i])
+    return 0.0;
+
+  if (r*r < cut_tholesq[itype][jtype]) {
+    asr = ascreen[itype][jtype] * r;
+    if (!tholetablebits || asr*asr <= tholetable->innersq) {
+      exp_asr = exp(-asr);
+      factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr))))
+        - factor_coul;
+      factor_e = 0.5*(2. - (exp_asr * (2. + asr))) - factor_coul;
+    } else {
+      tholetable->lookup(asr*asr,damp_f,damp_e,1);
+      factor_f = 1.0 - damp_f - factor_coul;
+      factor_e = 1.0 - damp_e - factor_coul;
+    }
+  } else if (factor_coul < 1.0) {
+    factor_f = factor_e = 1.0 - factor_coul;
+  } else return 0.0;
+
+  dcoul = force->qqrd2e * drude_dq[i] * drude_dq[j] / r;
+  ethole = factor_e * dcoul;
+  return factor_f * dcoul;
+}
+
+/* ----------------------------------------------------------------------
+   rRESPA inner level: bare Coulomb with Thole damping and LJ,
+   switched off between cut_respa[0] and cut_respa[1]
+------------------------------------------------------------------------- */
+
+void PairLJCutTholeLong::compute_inner()
+{
+  int i,j,ii,jj,inum,jnum,itype,jtype;
+  double qtmp,xtmp,ytmp,ztmp,delx,dely,delz,fpair;
+  double r,rsq,r2inv,r6inv,forcecoul,forcelj,factor_coul,factor_lj;
+  double rsw,ethole;
+  int *ilist,*jlist,*numneigh,**firstneigh;
+
+  double **x = atom->x;
+  double **f = atom->f;
+  double *q = atom->q;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  double *special_coul = force->special_coul;
+  double *special_lj = force->special_lj;
+  int newton_pair = force->newton_pair;
+  double qqrd2e = force->qqrd2e;
+
+  inum = listinner->inum;
+  ilist = listinner->ilist;
+  numneigh = listinner->numneigh;
+  firstneigh = listinner->firstneigh;
+
+  double cut_out_on = cut_respa[0];
+  double cut_out_off = cut_respa[1];
+
+  double cut_out_diff = cut_out_off - cut_out_on;
+  double cut_out_on_sq = cut_out_on*cut_out_on;
+  double cut_out_off_sq = cut_out_off*cut_out_off;
+
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    qtmp = q[i];
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    itype = type[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj];
+      factor_lj = special_lj[sbmask(j)];
+      factor_coul = special_coul[sbmask(j)];
+      j &= NEIGHMASK;
+
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+
+      if (rsq < cut_out_off_sq) {
+        r2inv = 1.0/rsq;
+        r = sqrt(rsq);
+        jtype = type[j];
+
+        forcecoul = qqrd2e * qtmp*q[j]/r;
+        if (factor_coul < 1.0) forcecoul -= (1.0-factor_coul)*forcecoul;
+        forcecoul += thole_force(i,j,itype,jtype,r,factor_coul,ethole);
+
+        if (rsq < cut_ljsq[itype][jtype]) {
+          r6inv = r2inv*r2inv*r2inv;
+          forcelj = r6inv * (lj1[itype][jtype]*r6inv - lj2[itype][jtype]);
+        } else forcelj = 0.0;
+
+        fpair = (forcecoul + factor_lj*forcelj) * r2inv;
+        if (rsq > cut_out_on_sq) {
+          rsw = (r - cut_out_on)/cut_out_diff;
+          fpair *= 1.0 - rsw*rsw*(3.0 - 2.0*rsw);
+        }
+
+        f[i][0] += delx*fpair;
+        f[i][1] += dely*fpair;
+        f[i][2] += delz*fpair;
+        if (newton_pair || j < nlocal) {
+          f[j][0] -= delx*fpair;
+          f[j][1] -= dely*fpair;
+          f[j][2] -= delz*fpair;
+        }
+      }
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   rRESPA middle level: same interactions as the inner level,
+   switched on between cut_respa[0] and cut_respa[1]
+   and off between cut_respa[2] and cut_respa[3]
+------------------------------------------------------------------------- */
+
+void PairLJCutTholeLong::compute_middle()
+{
+  int i,j,ii,jj,inum,jnum,itype,jtype;
+  double qtmp,xtmp,ytmp,ztmp,delx,dely,delz,fpair;
+  double r,rsq,r2inv,r6inv,forcecoul,forcelj,factor_coul,factor_lj;
+  double rsw,ethole;
+  int *ilist,*jlist,*numneigh,**firstneigh;
+
+  double **x = atom->x;
+  double **f = atom->f;
+  double *q = atom->q;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  double *special_coul = force->special_coul;
+  double *special_lj = force->special_lj;
+  int newton_pair = force->newton_pair;
+  double qqrd2e = force->qqrd2e;
+
+  inum = listmiddle->inum;
+  ilist = listmiddle->ilist;
+  numneigh = listmiddle->numneigh;
+  firstneigh = listmiddle->firstneigh;
+
+  double cut_in_off = cut_respa[0];
+  double cut_in_on = cut_respa[1];
+  double cut_out_on = cut_respa[2];
+  double cut_out_off = cut_respa[3];
+
+  double cut_in_diff = cut_in_on - cut_in_off;
+  double cut_out_diff = cut_out_off - cut_out_on;
+  double cut_in_off_sq = cut_in_off*cut_in_off;
+  double cut_in_on_sq = cut_in_on*cut_in_on;
+  double cut_out_on_sq = cut_out_on*cut_out_on;
+  double cut_out_off_sq = cut_out_off*cut_out_off;
+
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    qtmp = q[i];
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    itype = type[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj];
+      factor_lj = special_lj[sbmask(j)];
+      factor_coul = special_coul[sbmask(j)];
+      j &= NEIGHMASK;
+
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+
+      if (rsq < cut_out_off_sq && rsq > cut_in_off_sq) {
+        r2inv = 1.0/rsq;
+        r = sqrt(rsq);
+        jtype = type[j];
+
+        forcecoul = qqrd2e * qtmp*q[j]/r;
+        if (factor_coul < 1.0) forcecoul -= (1.0-factor_coul)*forcecoul;
+        forcecoul += thole_force(i,j,itype,jtype,r,factor_coul,ethole);
+
+        if (rsq < cut_ljsq[itype][jtype]) {
+          r6inv = r2inv*r2inv*r2inv;
+          forcelj = r6inv * (lj1[itype][jtype]*r6inv - lj2[itype][jtype]);
+        } else forcelj = 0.0;
+
+        fpair = (forcecoul + factor_lj*forcelj) * r2inv;
+        if (rsq < cut_in_on_sq) {
+          rsw = (r - cut_in_off)/cut_in_diff;
+          fpair *= rsw*rsw*(3.0 - 2.0*rsw);
+        }
+        if (rsq > cut_out_on_sq) {
+          rsw = (r - cut_out_on)/cut_out_diff;
+          fpair *= 1.0 + rsw*rsw*(2.0*rsw - 3.0);
+        }
+
+        f[i][0] += delx*fpair;
+        f[i][1] += dely*fpair;
+        f[i][2] += delz*fpair;
+        if (newton_pair || j < nlocal) {
+          f[j][0] -= delx*fpair;
+          f[j][1] -= dely*fpair;
+          f[j][2] -= delz*fpair;
+        }
+      }
+    }
+  }
+}
+
+/* ----------------------------------------------------------------------
+   rRESPA outer level: Ewald real space minus the part of the bare
+   Coulomb, Thole and LJ interactions already done at the inner levels
+   energy and virial are those of the full interaction
+------------------------------------------------------------------------- */
+
+void PairLJCutTholeLong::compute_outer(int eflag, int vflag)
+{
+  int i,j,ii,jj,inum,jnum,itype,jtype,itable;
+  double qtmp,xtmp,ytmp,ztmp,delx,dely,delz,evdwl,ecoul,fpair;
+  double fraction,table;
+  double r,rsq,r2inv,r6inv,forcecoul,forcelj,factor_coul,factor_lj;
+  double grij,expm2,prefactor,t,u,erfc;
+  double rsw,fthole,ethole;
+  int *ilist,*jlist,*numneigh,**firstneigh;
+
+  evdwl = ecoul = 0.0;
+  if (eflag || vflag) ev_setup(eflag,vflag);
+  else evflag = 0;
+
+  double **x = atom->x;
+  double **f = atom->f;
+  double *q = atom->q;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  double *special_coul = force->special_coul;
+  double *special_lj = force->special_lj;
+  int newton_pair = force->newton_pair;
+  double qqrd2e = force->qqrd2e;
+
+  inum = listouter->inum;
+  ilist = listouter->ilist;
+  numneigh = listouter->numneigh;
+  firstneigh = listouter->firstneigh;
+
+  double cut_in_off = cut_respa[2];
+  double cut_in_on = cut_respa[3];
+
+  double cut_in_diff = cut_in_on - cut_in_off;
+  double cut_in_off_sq = cut_in_off*cut_in_off;
+  double cut_in_on_sq = cut_in_on*cut_in_on;
+
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    qtmp = q[i];
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    itype = type[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj];
+      factor_lj = special_lj[sbmask(j)];
+      factor_coul = special_coul[sbmask(j)];
+      j &= NEIGHMASK;
+
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+      jtype = type[j];
+
+      if (rsq < cutsq[itype][jtype]) {
+        r2inv = 1.0/rsq;
+        r = sqrt(rsq);
+
+        // switching factor of the part done at the inner levels
+
+        if (rsq <= cut_in_off_sq) rsw = 0.0;
+        else if (rsq < cut_in_on_sq) {
+          rsw = (r - cut_in_off)/cut_in_diff;
+          rsw = rsw*rsw*(3.0 - 2.0*rsw);
+        } else rsw = 1.0;
+
+        if (rsq < cut_coulsq) {
+          fthole = thole_force(i,j,itype,jtype,r,factor_coul,ethole);
+          if (!ncoultablebits || rsq <= tabinnersq) {
+            grij = g_ewald * r;
+            expm2 = exp(-grij*grij);
+            t = 1.0 / (1.0 + EWALD_P*grij);
+            u = 1. - t;
+            erfc = t * (1.+u*(B0+u*(B1+u*(B2+u*(B3+u*(B4+u*B5)))))) * expm2;
+            prefactor = qqrd2e * qtmp*q[j]/r;
+            forcecoul = prefactor * (erfc + EWALD_F*grij*expm2 - 1.0);
+            forcecoul += rsw*prefactor;
+            if (factor_coul < 1.0)
+              forcecoul -= rsw*(1.0-factor_coul)*prefactor;
+          } else {
+            union_int_float_t rsq_lookup;
+            rsq_lookup.f = rsq;
+            itable = rsq_lookup.i & ncoulmask;
+            itable >>= ncoulshiftbits;
+            fraction = (rsq_lookup.f - rtable[itable]) * drtable[itable];
+            table = ftable[itable] + fraction*dftable[itable];
+            forcecoul = qtmp*q[j] * table;
+            if (factor_coul < 1.0) {
+              table = ctable[itable] + fraction*dctable[itable];
+              prefactor = qtmp*q[j] * table;
+              forcecoul -= (1.0-factor_coul)*prefactor;
+            }
+          }
+          forcecoul += rsw*fthole;
+        } else forcecoul = fthole = ethole = 0.0;
+
+        if (rsq < cut_ljsq[itype][jtype] && rsq > cut_in_off_sq) {
+          r6inv = r2inv*r2inv*r2inv;
+          forcelj = r6inv * (lj1[itype][jtype]*r6inv - lj2[itype][jtype]);
+          forcelj *= rsw;
+        } else forcelj = 0.0;
+
+        fpair = (forcecoul + factor_lj*forcelj) * r2inv;
+
+        f[i][0] += delx*fpair;
+        f[i][1] += dely*fpair;
+        f[i][2] += delz*fpair;
+        if (newton_pair || j < nlocal) {
+          f[j][0] -= delx*fpair;
+          f[j][1] -= dely*fpair;
+          f[j][2] -= delz*fpair;
+        }
+
+        if (eflag) {
+          if (rsq < cut_coulsq) {
+            if (!ncoultablebits || rsq <= tabinnersq) {
+              ecoul = prefactor*erfc;
+            } else {
+              table = etable[itable] + fraction*detable[itable];
+              ecoul = qtmp*q[j] * table;
+            }
+            if (factor_coul < 1.0) ecoul -= (1.0-factor_coul)*prefactor;
+            ecoul += ethole;
+          } else ecoul = 0.0;
+
+          if (rsq < cut_ljsq[itype][jtype]) {
+            r6inv = r2inv*r2inv*r2inv;
+            evdwl = r6inv*(lj3[itype][jtype]*r6inv-lj4[itype][jtype]) -
+              offset[itype][jtype];
+            evdwl *= factor_lj;
+          } else evdwl = 0.0;
+        }
+
+        // the virial is that of the full interaction
+
+        if (vflag) {
+          if (rsq < cut_coulsq) {
+            if (!ncoultablebits || rsq <= tabinnersq) {
+              forcecoul = prefactor * (erfc + EWALD_F*grij*expm2);
+              if (factor_coul < 1.0) forcecoul -= (1.0-factor_coul)*prefactor;
+            } else {
+              table = vtable[itable] + fraction*dvtable[itable];
+              forcecoul = qtmp*q[j] * table;
+              if (factor_coul < 1.0) {
+                table = ptable[itable] + fraction*dptable[itable];
+                prefactor = qtmp*q[j] * table;
+                forcecoul -= (1.0-factor_coul)*prefactor;
+              }
+            }
+            forcecoul += fthole;
+          } else forcecoul = 0.0;
+
+          if (rsq < cut_ljsq[itype][jtype]) {
+            r6inv = r2inv*r2inv*r2inv;
+            forcelj = r6inv * (lj1[itype][jtype]*r6inv - lj2[itype][jtype]);
+          } else forcelj = 0.0;
+
+          fpair = (forcecoul + factor_lj*forcelj) * r2inv;
+        }
+
+        if (evflag) ev_tally(i,j,nlocal,newton_pair,
+                             evdwl,ecoul,fpair,delx,dely,delz);
+      }
+    }
+  }
+}
+
 /* ----------------------------------------------------------------------
    allocate all arrays
 ------------------------------------------------------------------------- */
@@ -266,6 +709,8 @@ void PairLJCutTholeLong::allocate()
   memory->create(cut_ljsq,n+1,n+1,"pair:cut_ljsq");
   memory->create(scale,n+1,n+1,"pair:scale");
   memory->create(ascreen,n+1,n+1,"pair:ascreen");
+  memory->create(cut_thole,n+1,n+1,"pair:cut_thole");
+  memory->create(cut_tholesq,n+1,n+1,"pair:cut_tholesq");
   memory->create(thole,n+1,n+1,"pair:thole");
   memory->create(polar,n+1,n+1,"pair:polar");
   memory->create(epsilon,n+1,n+1,"pair:epsilon");
@@ -283,12 +728,14 @@ void PairLJCutTholeLong::allocate()
 
 void PairLJCutTholeLong::settings(int narg, char **arg)
 {
- if (narg < 2 || narg > 3) error->all(FLERR,"Illegal pair_style command");
+ if (narg < 2 || narg > 4) error->all(FLERR,"Illegal pair_style command");
 
   thole_global = force->numeric(FLERR,arg[0]);
   cut_lj_global = force->numeric(FLERR,arg[1]);
   if (narg == 2) cut_coul = cut_lj_global;
   else cut_coul = force->numeric(FLERR,arg[2]);
+  if (narg == 4) cut_thole_global = force->numeric(FLERR,arg[3]);
+  else cut_thole_global = -1.0;
 
   // reset cutoffs that have been explicitly set
 
@@ -299,6 +746,7 @@ void PairLJCutTholeLong::settings(int narg, char **arg)
           if (setflag[i][j]) {
               thole[i][j] = thole_global;
               cut_lj[i][j] = cut_lj_global;
+              cut_thole[i][j] = cut_thole_global;
           }
   }
 }
@@ -309,7 +757,7 @@ void PairLJCutTholeLong::settings(int narg, char **arg)
 
 void PairLJCutTholeLong::coeff(int narg, char **arg)
 {
-  if (narg < 5 || narg > 7)
+  if (narg < 5 || narg > 8)
     error->all(FLERR,"Incorrect args for pair coefficients");
   if (!allocated) allocate();
 
@@ -324,7 +772,9 @@ void PairLJCutTholeLong::coeff(int narg, char **arg)
   if (narg >=6) thole_one = force->numeric(FLERR,arg[5]);
 
   double cut_lj_one = cut_lj_global;
-  if (narg == 7) cut_lj_one = force->numeric(FLERR,arg[6]);
+  if (narg >= 7) cut_lj_one = force->numeric(FLERR,arg[6]);
+  double cut_thole_one = cut_thole_global;
+  if (narg == 8) cut_thole_one = force->numeric(FLERR,arg[7]);
 
   int count = 0;
   for (int i = ilo; i <= ihi; i++) {
@@ -335,6 +785,7 @@ void PairLJCutTholeLong::coeff(int narg, char **arg)
       thole[i][j] = thole_one;
       ascreen[i][j] = thole[i][j] / pow(polar[i][j], 1./3.);
       cut_lj[i][j] = cut_lj_one;
+      cut_thole[i][j] = cut_thole_one;
       scale[i][j] = 1.0;
       setflag[i][j] = 1;
       count++;
@@ -344,6 +795,32 @@ void PairLJCutTholeLong::coeff(int narg, char **arg)
   if (count == 0) error->all(FLERR,"Incorrect args for pair coefficients");
 }
 
+/* ----------------------------------------------------------------------
+   pair_modify keyword for the damping table, others go to Pair
+------------------------------------------------------------------------- */
+
+void PairLJCutTholeLong::modify_params(int narg, char **arg)
+{
+  if (narg == 0) error->all(FLERR,"Illegal pair_modify command");
+
+  char **rest = new char*[narg];
+  int nrest = 0;
+
+  int iarg = 0;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"thole/table") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal pair_modify command");
+      tholetablebits = force->inumeric(FLERR,arg[iarg+1]);
+      if (tholetablebits < 0 || tholetablebits > (int) sizeof(int)*8)
+        error->all(FLERR,"Illegal pair_modify command");
+      iarg += 2;
+    } else rest[nrest++] = arg[iarg++];
+  }
+
+  if (nrest) Pair::modify_params(nrest,rest);
+  delete [] rest;
+}
+
 /* ----------------------------------------------------------------------
    init specific to this pair style
 ------------------------------------------------------------------------- */
@@ -359,13 +836,50 @@ void PairLJCutTholeLong::init_style()
       error->all(FLERR, "Pair style lj/cut/thole/long requires fix drude");
   fix_drude = (FixDrude *) modify->fix[ifix];
 
-  int irequest = neighbor->request(this,instance_me);
+  // request regular or rRESPA neighbor lists
+
+  int irequest;
+
+  if (update->whichflag == 1 && strstr(update->integrate_style,"respa")) {
+    int respa = 0;
+    if (((Respa *) update->integrate)->level_inner >= 0) respa = 1;
+    if (((Respa *) update->integrate)->level_middle >= 0) respa = 2;
+
+    if (respa == 0) irequest = neighbor->request(this,instance_me);
+    else if (respa == 1) {
+      irequest = neighbor->request(this,instance_me);
+      neighbor->requests[irequest]->id = 1;
+      neighbor->requests[irequest]->half = 0;
+      neighbor->requests[irequest]->respainner = 1;
+      irequest = neighbor->request(this,instance_me);
+      neighbor->requests[irequest]->id = 3;
+      neighbor->requests[irequest]->half = 0;
+      neighbor->requests[irequest]->respaouter = 1;
+    } else {
+      irequest = neighbor->request(this,instance_me);
+      neighbor->requests[irequest]->id = 1;
+      neighbor->requests[irequest]->half = 0;
+      neighbor->requests[irequest]->respainner = 1;
+      irequest = neighbor->request(this,instance_me);
+      neighbor->requests[irequest]->id = 2;
+      neighbor->requests[irequest]->half = 0;
+      neighbor->requests[irequest]->respamiddle = 1;
+      irequest = neighbor->request(this,instance_me);
+      neighbor->requests[irequest]->id = 3;
+      neighbor->requests[irequest]->half = 0;
+      neighbor->requests[irequest]->respaouter = 1;
+    }
+
+  } else irequest = neighbor->request(this,instance_me);
 
   cut_coulsq = cut_coul * cut_coul;
 
   // set rRESPA cutoffs
 
-  cut_respa = NULL;
+  if (strstr(update->integrate_style,"respa") &&
+      ((Respa *) update->integrate)->level_inner >= 0)
+    cut_respa = ((Respa *) update->integrate)->cutoff;
+  else cut_respa = NULL;
 
   // insure use of KSpace long-range solver, set g_ewald
 
@@ -376,6 +890,7 @@ void PairLJCutTholeLong::init_style()
   // setup force tables
 
   if (ncoultablebits) init_tables(cut_coul,cut_respa);
+  tholetable->init(tholetablebits);
 }
 
 /* ----------------------------------------------------------------------
@@ -405,8 +920,16 @@ double PairLJCutTholeLong::init_one(int i, int j)
     polar[i][j] = sqrt(polar[i][i] * polar[j][j]);
     thole[i][j] = 0.5 * (thole[i][i] + thole[j][j]);
     ascreen[i][j] = thole[i][j] / pow(polar[i][j], 1./3.);
+    cut_thole[i][j] = cut_thole_global;
   }
 
+  // Thole cutoff, by default where the damping is below THOLE_ACC
+
+  double cut_thole_one = cut_thole[i][j];
+  if (cut_thole_one < 0.0) cut_thole_one = thole_range() / ascreen[i][j];
+  cut_thole_one = MIN(cut_thole_one,cut_coul);
+  cut_tholesq[i][j] = cut_thole_one * cut_thole_one;
+
   // include TIP4P qdist in full cutoff, qdist = 0.0 if not TIP4P
 
   double cut = MAX(cut_lj[i][j],cut_coul+2.0*qdist);
@@ -431,6 +954,8 @@ double PairLJCutTholeLong::init_one(int i, int j)
   polar[j][i] = polar[i][j];
   thole[j][i] = thole[i][j];
   ascreen[j][i] = ascreen[i][j];
+  cut_thole[j][i] = cut_thole[i][j];
+  cut_tholesq[j][i] = cut_tholesq[i][j];
   scale[j][i] = scale[i][j];
 
   // check interior rRESPA cutoff
@@ -485,6 +1010,7 @@ void PairLJCutTholeLong::write_restart(FILE *fp)
         fwrite(&polar[i][j],sizeof(double),1,fp);
         fwrite(&thole[i][j],sizeof(double),1,fp);
         fwrite(&cut_lj[i][j],sizeof(double),1,fp);
+        fwrite(&cut_thole[i][j],sizeof(double),1,fp);
       }
     }
 }
@@ -513,6 +1039,7 @@ void PairLJCutTholeLong::read_restart(FILE *fp)
           fread(&thole[i][j],sizeof(double),1,fp);
           ascreen[i][j] = thole[i][j] / pow(polar[i][j], 1./3.);
           fread(&cut_lj[i][j],sizeof(double),1,fp);
+          fread(&cut_thole[i][j],sizeof(double),1,fp);
         }
         MPI_Bcast(&epsilon[i][j],1,MPI_DOUBLE,0,world);
         MPI_Bcast(&sigma[i][j],1,MPI_DOUBLE,0,world);
@@ -520,6 +1047,7 @@ void PairLJCutTholeLong::read_restart(FILE *fp)
         MPI_Bcast(&thole[i][j],1,MPI_DOUBLE,0,world);
         MPI_Bcast(&ascreen[i][j],1,MPI_DOUBLE,0,world);
         MPI_Bcast(&cut_lj[i][j],1,MPI_DOUBLE,0,world);
+        MPI_Bcast(&cut_thole[i][j],1,MPI_DOUBLE,0,world);
       }
     }
 }
@@ -534,11 +1062,13 @@ void PairLJCutTholeLong::write_restart_settings(FILE *fp)
   fwrite(&cut_coul,sizeof(double),1,fp);
   fwrite(&thole_global,sizeof(double),1,fp);
   fwrite(&cut_global,sizeof(double),1,fp);
+  fwrite(&cut_thole_global,sizeof(double),1,fp);
   fwrite(&offset_flag,sizeof(int),1,fp);
   fwrite(&mix_flag,sizeof(int),1,fp);
   fwrite(&tail_flag,sizeof(int),1,fp);
   fwrite(&ncoultablebits,sizeof(int),1,fp);
   fwrite(&tabinner,sizeof(double),1,fp);
+  fwrite(&tholetablebits,sizeof(int),1,fp);
 }
 
 /* ----------------------------------------------------------------------
@@ -552,21 +1082,25 @@ void PairLJCutTholeLong::read_restart_settings(FILE *fp)
     fread(&cut_coul,sizeof(double),1,fp);
     fread(&thole_global,sizeof(double),1,fp);
     fread(&cut_global,sizeof(double),1,fp);
+    fread(&cut_thole_global,sizeof(double),1,fp);
     fread(&offset_flag,sizeof(int),1,fp);
     fread(&mix_flag,sizeof(int),1,fp);
     fread(&tail_flag,sizeof(int),1,fp);
     fread(&ncoultablebits,sizeof(int),1,fp);
     fread(&tabinner,sizeof(double),1,fp);
+    fread(&tholetablebits,sizeof(int),1,fp);
   }
   MPI_Bcast(&cut_lj_global,1,MPI_DOUBLE,0,world);
   MPI_Bcast(&cut_coul,1,MPI_DOUBLE,0,world);
   MPI_Bcast(&thole_global,1,MPI_DOUBLE,0,world);
   MPI_Bcast(&cut_global,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&cut_thole_global,1,MPI_DOUBLE,0,world);
   MPI_Bcast(&offset_flag,1,MPI_INT,0,world);
   MPI_Bcast(&mix_flag,1,MPI_INT,0,world);
   MPI_Bcast(&tail_flag,1,MPI_INT,0,world);
   MPI_Bcast(&ncoultablebits,1,MPI_INT,0,world);
   MPI_Bcast(&tabinner,1,MPI_DOUBLE,0,world);
+  MPI_Bcast(&tholetablebits,1,MPI_INT,0,world);
 }
 
 
@@ -588,7 +1122,8 @@ void PairLJCutTholeLong::write_data_all(FILE *fp)
 {
   for (int i = 1; i <= atom->ntypes; i++)
     for (int j = i; j <= atom->ntypes; j++)
-      fprintf(fp,"%d %d %g %g %g %g %g\n",i,j,epsilon[i][j],sigma[i][j],polar[i][j],thole[i][j],cut_lj[i][j]);
+      fprintf(fp,"%d %d %g %g %g %g %g %g\n",i,j,epsilon[i][j],sigma[i][j],
+              polar[i][j],thole[i][j],cut_lj[i][j],sqrt(cut_tholesq[i][j]));
 }
 
 /* ---------------------------------------------------------------------- */
@@ -601,11 +1136,12 @@ double PairLJCutTholeLong::single(int i, int j, int itype, int jtype,
   double fraction,table,forcecoul,forcelj,phicoul,philj;
   int itable;
   double factor_f,factor_e;
-  double dqi,dqj,dcoul,asr,exp_asr;
-  int di, dj, di_closest;
+  double dqi,dqj,dcoul,asr,exp_asr,damp_f,damp_e;
+  int tholeflag = 0;
 
   int *drudetype = fix_drude->drudetype;
-  tagint *drudeid = fix_drude->drudeid;
+  int *drude_local = fix_drude->drude_local;
+  double *drude_dq = fix_drude->drude_dq;
   int *type = atom->type;
 
   r2inv = 1.0/rsq;
@@ -634,23 +1170,30 @@ double PairLJCutTholeLong::single(int i, int j, int itype, int jtype,
         forcecoul -= (1.0-factor_coul)*prefactor;
       }
     }
-    if (drudetype[type[i]] != NOPOL_TYPE && drudetype[type[j]] != NOPOL_TYPE) {
-      di = atom->map(drudeid[i]);
-      di_closest = domain->closest_image(i, di);
-      if (j != di_closest){
-        if (drudetype[i] == CORE_TYPE) dqi = -atom->q[di];
-        else if (drudetype[i] == DRUDE_TYPE) dqi = atom->q[i];
-        if (drudetype[j] == CORE_TYPE) {
-          dj = atom->map(drudeid[j]);
-          dqj = -atom->q[dj];
-        } else if (drudetype[j] == DRUDE_TYPE) dqj = atom->q[j];
+    if (drudetype[type[i]] != NOPOL_TYPE && drudetype[type[j]] != NOPOL_TYPE &&
+        j != drude_local[i]) {
+      if (rsq < cut_tholesq[itype][jtype]) {
         asr = ascreen[itype][jtype] * r;
-        exp_asr = exp(-asr);
+        if (!tholetablebits || asr*asr <= tholetable->innersq) {
+          exp_asr = exp(-asr);
+          factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr))))
+              - factor_coul;
+          factor_e = 0.5*(2. - (exp_asr * (2. + asr))) - factor_coul;
+        } else {
+          tholetable->lookup(asr*asr,damp_f,damp_e,1);
+          factor_f = 1.0 - damp_f - factor_coul;
+          factor_e = 1.0 - damp_e - factor_coul;
+        }
+        tholeflag = 1;
+      } else if (factor_coul < 1.0) {
+        factor_f = factor_e = 1.0 - factor_coul;
+        tholeflag = 1;
+      }
+      if (tholeflag) {
+        dqi = drude_dq[i];
+        dqj = drude_dq[j];
         dcoul = force->qqrd2e * dqi * dqj / r;
-        factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr))))
-            - factor_coul;
         forcecoul += factor_f * dcoul;
-        factor_e = 0.5*(2. - (exp_asr * (2. + asr))) - factor_coul;
       }
     }
   } else forcecoul = 0.0;
@@ -671,9 +1214,7 @@ double PairLJCutTholeLong::single(int i, int j, int itype, int jtype,
       phicoul = atom->q[i]*atom->q[j] * table;
     }
     if (factor_coul < 1.0) phicoul -= (1.0-factor_coul)*prefactor;
-    if (drudetype[type[i]] != NOPOL_TYPE && drudetype[type[j]] != NOPOL_TYPE &&
-        di_closest != j)
-      phicoul += factor_e * dcoul;
+    if (tholeflag) phicoul += factor_e * dcoul;
     eng += phicoul;
   }
 
@@ -699,5 +1240,6 @@ void *PairLJCutTholeLong::extract(const char *str, int &dim)
   if (strcmp(str,"polar") == 0) return (void *) polar;
   if (strcmp(str,"thole") == 0) return (void *) thole;
   if (strcmp(str,"ascreen") == 0) return (void *) ascreen;
+  if (strcmp(str,"cut_thole") == 0) return (void *) cut_thole;
   return NULL;
 }
@@ -31,8 +31,12 @@ class PairLJCutTholeLong : public Pair {
   PairLJCutTholeLong(class LAMMPS *);
   virtual ~PairLJCutTholeLong();
   virtual void compute(int, int);
+  virtual void compute_inner();
+  virtual void compute_middle();
+  virtual void compute_outer(int, int);
   virtual void settings(int, char **);
   void coeff(int, char **);
+  void modify_params(int, char **);
   virtual void init_style();
   void init_list(int, class NeighList *);
   virtual double init_one(int, int);
@@ -59,9 +63,14 @@ class PairLJCutTholeLong : public Pair {
   double cut_global;
   double **cut,**scale;
   double **polar,**thole,**ascreen;
+  double cut_thole_global;  // < 0 for the accuracy-based default
+  double **cut_thole,**cut_tholesq;
   FixDrude *fix_drude;
+  int tholetablebits;       // 2^N entries in the damping table, 0 = none
+  class TholeTable *tholetable;
 
   virtual void allocate();
+  double thole_force(int, int, int, int, double, double, double &);
 };
 
 }
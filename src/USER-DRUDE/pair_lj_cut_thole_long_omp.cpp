@@ -28,6 +28,7 @@
 #include "neigh_request.h"
 #include "math_const.h"
 #include "error.h"
+#include "thole_table.h"
 #include "suffix.h"
 
 using namespace LAMMPS_NS;
@@ -105,7 +106,8 @@ void PairLJCutTholeLongOMP::eval(int iifrom, int iito, ThrData * const thr)
   const int * _noalias const numneigh = list->numneigh;
   const int * const * const firstneigh = list->firstneigh;
   const int * _noalias const drudetype = fix_drude->drudetype;
-  const tagint * _noalias const drudeid = fix_drude->drudeid;
+  const int * _noalias const drude_local = fix_drude->drude_local;
+  const double * _noalias const drude_dq = fix_drude->drude_dq;
 
   double xtmp,ytmp,ztmp,delx,dely,delz,fxtmp,fytmp,fztmp;
   
@@ -117,9 +119,8 @@ void PairLJCutTholeLongOMP::eval(int iifrom, int iito, ThrData * const thr)
   double fraction,table;
   double grij,expm2,prefactor,t,erfc,u;
   double factor_f,factor_e;
-  int di,dj;
-  double qj,dqi,dqj,dcoul,asr,exp_asr;
-  int di_closest;
+  double qj,dqi,dqj,dcoul,asr,exp_asr,damp_f,damp_e;
+  int di_closest,tholeflag;
   const double qqrd2e = force->qqrd2e;
 
   evdwl = ecoul = 0.0;
@@ -132,6 +133,7 @@ void PairLJCutTholeLongOMP::eval(int iifrom, int iito, ThrData * const thr)
     const int * _noalias const jlist = firstneigh[i];
     const double * _noalias const cutsqi = cutsq[itype];
     const double * _noalias const cut_ljsqi = cut_ljsq[itype];
+    const double * _noalias const cut_tholesqi = cut_tholesq[itype];
     const double * _noalias const offseti = offset[itype];
     const double * _noalias const lj1i = lj1[itype];
     const double * _noalias const lj2i = lj2[itype];
@@ -145,13 +147,9 @@ void PairLJCutTholeLongOMP::eval(int iifrom, int iito, ThrData * const thr)
     fxtmp=fytmp=fztmp=0.;
 
     if (drudetype[type[i]] != NOPOL_TYPE){
-      di = atom->map(drudeid[i]);
-      if (di < 0) error->all(FLERR, "Drude partner not found");
-      di_closest = domain->closest_image(i, di);
-      if (drudetype[type[i]] == CORE_TYPE)
-        dqi = -q[di];
-      else
-        dqi = qi;
+      di_closest = drude_local[i];
+      if (di_closest < 0) error->one(FLERR, "Drude partner not found");
+      dqi = drude_dq[i];
     }
 
     for (jj = 0; jj < jnum; jj++) {
@@ -197,20 +195,30 @@ void PairLJCutTholeLongOMP::eval(int iifrom, int iito, ThrData * const thr)
             }
           }
 
+          tholeflag = 0;
           if (drudetype[type[i]] != NOPOL_TYPE &&
-              drudetype[type[j]] != NOPOL_TYPE){
-            if (j != di_closest){
-              if (drudetype[type[j]] == CORE_TYPE){
-                dj = atom->map(drudeid[j]);
-                dqj = -q[dj];
-              } else dqj = qj;
-              asr = ascreen[type[i]][type[j]] * r;
-              exp_asr = exp(-asr);
+              drudetype[type[j]] != NOPOL_TYPE && j != di_closest) {
+            if (rsq < cut_tholesqi[jtype]) {
+              asr = ascreen[itype][jtype] * r;
+              if (!tholetablebits || asr*asr <= tholetable->innersq) {
+                exp_asr = exp(-asr);
+                factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr))))
+                    - factor_coul;
+                if (EFLAG) factor_e = 0.5*(2. - (exp_asr * (2. + asr)))
+                               - factor_coul;
+              } else {
+                tholetable->lookup(asr*asr,damp_f,damp_e,EFLAG);
+                factor_f = 1.0 - damp_f - factor_coul;
+                if (EFLAG) factor_e = 1.0 - damp_e - factor_coul;
+              }
+              tholeflag = 1;
+            } else if (factor_coul < 1.0) {
+              factor_f = factor_e = 1.0 - factor_coul;
+              tholeflag = 1;
+            }
+            if (tholeflag) {
+              dqj = drude_dq[j];
               dcoul = qqrd2e * dqi * dqj / r;
-              factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr))))
-                  - factor_coul;
-              if (EFLAG) factor_e = 0.5*(2. - (exp_asr * (2. + asr)))
-                             - factor_coul;
               forcecoul += factor_f * dcoul;
             }
           }
@@ -241,10 +249,7 @@ void PairLJCutTholeLongOMP::eval(int iifrom, int iito, ThrData * const thr)
               ecoul = qi*qj * table;
             }
             if (factor_coul < 1.0) ecoul -= (1.0-factor_coul)*prefactor;
-            if (drudetype[type[i]] != NOPOL_TYPE &&
-                drudetype[type[j]] != NOPOL_TYPE && j != di_closest){
-              ecoul += factor_e * dcoul;
-            }
+            if (tholeflag) ecoul += factor_e * dcoul;
           } else ecoul = 0.0;
 
           if (rsq < cut_ljsqi[jtype]) {
@@ -0,0 +1,297 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Real space part of the Ewald dispersion sum, as in lj/long/coul/long,
+   with the Thole-damped Coulomb interaction of lj/cut/thole/long
+------------------------------------------------------------------------- */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pair_lj_long_thole_long.h"
+#include "atom.h"
+#include "force.h"
+#include "kspace.h"
+#include "neigh_list.h"
+#include "error.h"
+#include "thole_table.h"
+
+using namespace LAMMPS_NS;
+
+#define EWALD_F   1.12837917
+#define EWALD_P   9.95473818e-1
+#define B0       -0.1335096380159268
+#define B1       -2.57839507e-1
+#define B2       -1.37203639e-1
+#define B3       -8.88822059e-3
+#define B4       -5.80844129e-3
+#define B5        1.14652755e-1
+
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+
+/* ---------------------------------------------------------------------- */
+
+PairLJLongTholeLong::PairLJLongTholeLong(LAMMPS *lmp) : PairLJCutTholeLong(lmp)
+{
+  dispersionflag = 1;
+  respa_enable = 0;
+  ewald_order = (1<<1) | (1<<6);
+  g_ewald_6 = 0.0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairLJLongTholeLong::compute(int eflag, int vflag)
+{
+  int i,j,ii,jj,inum,jnum,itype,jtype,itable,ni;
+  double qi,qj,xtmp,ytmp,ztmp,delx,dely,delz,ecoul,fpair,evdwl;
+  double r,rsq,r2inv,forcecoul,factor_coul,forcelj,factor_lj,r6inv;
+  double fraction,table;
+  double grij,expm2,prefactor,t,erfc,u;
+  double x2,a2,tlj;
+  int *ilist,*jlist,*numneigh,**firstneigh;
+  double ethole;
+
+  evdwl = ecoul = 0.0;
+  if (eflag || vflag) ev_setup(eflag,vflag);
+  else evflag = vflag_fdotr = 0;
+
+  double **x = atom->x;
+  double **f = atom->f;
+  double *q = atom->q;
+  int *type = atom->type;
+  int nlocal = atom->nlocal;
+  double *special_coul = force->special_coul;
+  double *special_lj = force->special_lj;
+  int newton_pair = force->newton_pair;
+  double qqrd2e = force->qqrd2e;
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+
+  double g2 = g_ewald_6*g_ewald_6;
+  double g6 = g2*g2*g2;
+  double g8 = g6*g2;
+
+  inum = list->inum;
+  ilist = list->ilist;
+  numneigh = list->numneigh;
+  firstneigh = list->firstneigh;
+
+  // loop over neighbors of my atoms
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    qi = q[i];
+    xtmp = x[i][0];
+    ytmp = x[i][1];
+    ztmp = x[i][2];
+    itype = type[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    if (drudetype[itype] != NOPOL_TYPE && drude_local[i] < 0)
+      error->one(FLERR, "Drude partner not found");
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj];
+      ni = sbmask(j);
+      factor_lj = special_lj[ni];
+      factor_coul = special_coul[ni];
+      j &= NEIGHMASK;
+
+      delx = xtmp - x[j][0];
+      dely = ytmp - x[j][1];
+      delz = ztmp - x[j][2];
+      rsq = delx*delx + dely*dely + delz*delz;
+      jtype = type[j];
+
+      if (rsq < cutsq[itype][jtype]) {
+        r2inv = 1.0/rsq;
+
+        if (rsq < cut_coulsq) {
+          qj = q[j];
+          r = sqrt(rsq);
+
+          if (!ncoultablebits || rsq <= tabinnersq) {
+            grij = g_ewald * r;
+            expm2 = exp(-grij*grij);
+            t = 1.0 / (1.0 + EWALD_P*grij);
+            u = 1. - t;
+            erfc = t * (1.+u*(B0+u*(B1+u*(B2+u*(B3+u*(B4+u*B5)))))) * expm2;
+            prefactor = qqrd2e * qi*qj/r;
+            forcecoul = prefactor * (erfc + EWALD_F*grij*expm2);
+            if (factor_coul < 1.0) forcecoul -= (1.0-factor_coul)*prefactor;
+          } else {
+            union_int_float_t rsq_lookup;
+            rsq_lookup.f = rsq;
+            itable = rsq_lookup.i & ncoulmask;
+            itable >>= ncoulshiftbits;
+            fraction = (rsq_lookup.f - rtable[itable]) * drtable[itable];
+            table = ftable[itable] + fraction*dftable[itable];
+            forcecoul = qi*qj * table;
+            if (factor_coul < 1.0) {
+              table = ctable[itable] + fraction*dctable[itable];
+              prefactor = qi*qj * table;
+              forcecoul -= (1.0-factor_coul)*prefactor;
+            }
+          }
+
+          // Thole screening of the Drude charges, as in lj/cut/thole/long
+
+          forcecoul += thole_force(i,j,itype,jtype,r,factor_coul,ethole);
+        } else forcecoul = 0.0;
+
+        // real space dispersion, the special pairs get back
+        // (1-factor_lj) of the full r^-6 term
+
+        if (rsq < cut_ljsq[itype][jtype]) {
+          r6inv = r2inv*r2inv*r2inv;
+          x2 = g2*rsq;
+          a2 = 1.0/x2;
+          x2 = a2*exp(-x2)*lj4[itype][jtype];
+          if (ni == 0) {
+            forcelj = r6inv*r6inv*lj1[itype][jtype] -
+              g8*(((6.0*a2+6.0)*a2+3.0)*a2+1.0)*x2*rsq;
+            if (eflag)
+              evdwl = r6inv*r6inv*lj3[itype][jtype] -
+                g6*((a2+1.0)*a2+0.5)*x2;
+          } else {
+            tlj = r6inv*(1.0-factor_lj);
+            forcelj = factor_lj*r6inv*r6inv*lj1[itype][jtype] -
+              g8*(((6.0*a2+6.0)*a2+3.0)*a2+1.0)*x2*rsq +
+              tlj*lj2[itype][jtype];
+            if (eflag)
+              evdwl = factor_lj*r6inv*r6inv*lj3[itype][jtype] -
+                g6*((a2+1.0)*a2+0.5)*x2 + tlj*lj4[itype][jtype];
+          }
+        } else forcelj = evdwl = 0.0;
+
+        fpair = (forcecoul + forcelj) * r2inv;
+
+        f[i][0] += delx*fpair;
+        f[i][1] += dely*fpair;
+        f[i][2] += delz*fpair;
+        if (newton_pair || j < nlocal) {
+          f[j][0] -= delx*fpair;
+          f[j][1] -= dely*fpair;
+          f[j][2] -= delz*fpair;
+        }
+
+        if (eflag) {
+          if (rsq < cut_coulsq) {
+            if (!ncoultablebits || rsq <= tabinnersq)
+              ecoul = prefactor*erfc;
+            else {
+              table = etable[itable] + fraction*detable[itable];
+              ecoul = qi*qj * table;
+            }
+            if (factor_coul < 1.0) ecoul -= (1.0-factor_coul)*prefactor;
+            ecoul += ethole;
+          } else ecoul = 0.0;
+        }
+
+        if (evflag) ev_tally(i,j,nlocal,newton_pair,
+                             evdwl,ecoul,fpair,delx,dely,delz);
+      }
+    }
+  }
+
+  if (vflag_fdotr) virial_fdotr_compute();
+}
+
+/* ----------------------------------------------------------------------
+   init specific to this pair style
+------------------------------------------------------------------------- */
+
+void PairLJLongTholeLong::init_style()
+{
+  if (tail_flag)
+    error->all(FLERR,
+               "Pair style lj/long/thole/long does not support tail corrections");
+
+  PairLJCutTholeLong::init_style();
+
+  if (!force->kspace->dispersionflag)
+    error->all(FLERR,"Pair style lj/long/thole/long requires "
+               "a KSpace style with dispersion");
+  g_ewald_6 = force->kspace->g_ewald_6;
+}
+
+/* ----------------------------------------------------------------------
+   init for one type pair i,j and corresponding j,i
+   the KSpace splitting of the dispersion needs the same LJ cutoff
+   for all pairs, and no energy offset
+------------------------------------------------------------------------- */
+
+double PairLJLongTholeLong::init_one(int i, int j)
+{
+  PairLJCutTholeLong::init_one(i,j);
+
+  cut_lj[i][j] = cut_lj_global;
+  cut_ljsq[i][j] = cut_ljsq[j][i] = cut_lj_global * cut_lj_global;
+  offset[i][j] = offset[j][i] = 0.0;
+
+  return MAX(cut_lj_global,cut_coul);
+}
+
+/* ---------------------------------------------------------------------- */
+
+double PairLJLongTholeLong::single(int i, int j, int itype, int jtype,
+                                   double rsq, double factor_coul,
+                                   double factor_lj, double &fforce)
+{
+  double r2inv,r6inv,x2,a2,tlj,forcelj,philj;
+
+  // Coulomb and Thole part from lj/cut/thole/long, without its LJ
+
+  double eng = PairLJCutTholeLong::single(i,j,itype,jtype,rsq,
+                                          factor_coul,0.0,fforce);
+
+  if (rsq < cut_ljsq[itype][jtype]) {
+    double g2 = g_ewald_6*g_ewald_6;
+    double g6 = g2*g2*g2;
+    double g8 = g6*g2;
+
+    r2inv = 1.0/rsq;
+    r6inv = r2inv*r2inv*r2inv;
+    x2 = g2*rsq;
+    a2 = 1.0/x2;
+    x2 = a2*exp(-x2)*lj4[itype][jtype];
+    tlj = r6inv*(1.0-factor_lj);
+    forcelj = factor_lj*r6inv*r6inv*lj1[itype][jtype] -
+      g8*(((6.0*a2+6.0)*a2+3.0)*a2+1.0)*x2*rsq + tlj*lj2[itype][jtype];
+    philj = factor_lj*r6inv*r6inv*lj3[itype][jtype] -
+      g6*((a2+1.0)*a2+0.5)*x2 + tlj*lj4[itype][jtype];
+
+    fforce += forcelj * r2inv;
+    eng += philj;
+  }
+
+  return eng;
+}
+
+/* ----------------------------------------------------------------------
+   quantities needed by the ewald/disp and pppm/disp KSpace styles
+------------------------------------------------------------------------- */
+
+void *PairLJLongTholeLong::extract(const char *str, int &dim)
+{
+  dim = 0;
+  if (strcmp(str,"ewald_order") == 0) return (void *) &ewald_order;
+  if (strcmp(str,"ewald_mix") == 0) return (void *) &mix_flag;
+  if (strcmp(str,"cut_LJ") == 0) return (void *) &cut_lj_global;
+  dim = 2;
+  if (strcmp(str,"B") == 0) return (void *) lj4;
+  return PairLJCutTholeLong::extract(str,dim);
+}
@@ -0,0 +1,66 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#ifdef PAIR_CLASS
+
+PairStyle(lj/long/thole/long,PairLJLongTholeLong)
+
+#else
+
+#ifndef LMP_PAIR_LJ_LONG_THOLE_LONG_H
+#define LMP_PAIR_LJ_LONG_THOLE_LONG_H
+
+#include "pair_lj_cut_thole_long.h"
+
+namespace LAMMPS_NS {
+
+class PairLJLongTholeLong : public PairLJCutTholeLong {
+
+ public:
+  PairLJLongTholeLong(class LAMMPS *);
+  virtual ~PairLJLongTholeLong() {}
+  virtual void compute(int, int);
+  virtual void init_style();
+  virtual double init_one(int, int);
+  virtual double single(int, int, int, int, double, double, double, double &);
+  virtual void *extract(const char *, int &);
+
+ protected:
+  int ewald_order;          // bit mask of the 1/r^n terms done by KSpace
+  double g_ewald_6;
+};
+
+}
+
+#endif
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Pair style lj/long/thole/long requires a KSpace style with dispersion
+
+The real space part of the dispersion sum is only correct with a
+KSpace style such as ewald/disp or pppm/disp that computes its
+reciprocal space part.
+
+E: Pair style lj/long/thole/long does not support tail corrections
+
+The dispersion is summed to infinity by the Ewald method, so there
+is no tail to correct.
+
+E: Drude partner not found
+
+The Drude partner of a polarizable atom is neither a local nor a
+ghost atom.  The communication cutoff may be too short.
+
+*/
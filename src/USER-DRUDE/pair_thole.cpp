@@ -25,13 +25,25 @@
 #include "error.h"
 #include "fix.h"
 #include "fix_store.h"
+#include "thole_table.h"
 
 using namespace LAMMPS_NS;
 
+#define PGDELTA 1
+
 /* ---------------------------------------------------------------------- */
 
 PairThole::PairThole(LAMMPS *lmp) : Pair(lmp) {
     fix_drude = NULL;
+    tholetablebits = 0;
+    tholetable = new TholeTable(lmp);
+
+    pol_inum = maxlocal = 0;
+    pol_ilist = NULL;
+    pol_numneigh = NULL;
+    pol_firstneigh = NULL;
+    ipage = NULL;
+    pgsize = oneatom = 0;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -47,19 +59,24 @@ PairThole::~PairThole()
     memory->destroy(cut);
     memory->destroy(scale);
   }
+  delete tholetable;
+
+  memory->destroy(pol_ilist);
+  memory->destroy(pol_numneigh);
+  memory->sfree(pol_firstneigh);
+  delete [] ipage;
 }
 
 /* ---------------------------------------------------------------------- */
 
 void PairThole::compute(int eflag, int vflag)
 {
-  int i,j,ii,jj,inum,jnum,itype,jtype;
+  int i,j,ii,jj,jnum,itype,jtype;
   double qi,qj,xtmp,ytmp,ztmp,delx,dely,delz,ecoul,fpair;
   double r,rsq,r2inv,rinv,factor_coul;
-  int *ilist,*jlist,*numneigh,**firstneigh;
+  int *jlist;
   double factor_f,factor_e;
-  int di,dj;
-  double dcoul,asr,exp_asr;
+  double dcoul,asr,exp_asr,damp_f,damp_e;
 
   ecoul = 0.0;
   if (eflag || vflag) ev_setup(eflag,vflag);
@@ -67,59 +84,36 @@ void PairThole::compute(int eflag, int vflag)
 
   double **x = atom->x;
   double **f = atom->f;
-  double *q = atom->q;
   int *type = atom->type;
   int nlocal = atom->nlocal;
   double *special_coul = force->special_coul;
   int newton_pair = force->newton_pair;
   double qqrd2e = force->qqrd2e;
-  int *drudetype = fix_drude->drudetype;
-  tagint *drudeid = fix_drude->drudeid;
+  double *drude_dq = fix_drude->drude_dq;
 
-  inum = list->inum;
-  ilist = list->ilist;
-  numneigh = list->numneigh;
-  firstneigh = list->firstneigh;
+  if (neighbor->ago == 0) build_pol_list();
 
-  // loop over neighbors of my atoms
+  // loop over polarizable neighbors of my polarizable atoms
 
-  for (ii = 0; ii < inum; ii++) {
-    i = ilist[ii];
-
-    // only on core-drude pair
-    if (drudetype[type[i]] == NOPOL_TYPE)
-      continue;
+  for (ii = 0; ii < pol_inum; ii++) {
+    i = pol_ilist[ii];
 
-    di = domain->closest_image(i, atom->map(drudeid[i]));
-    // get dq of the core via the drude charge
-    if (drudetype[type[i]] == DRUDE_TYPE)
-      qi = q[i];
-    else
-      qi = -q[di];
+    // dq of the core is minus the drude charge
+    qi = drude_dq[i];
 
     xtmp = x[i][0];
     ytmp = x[i][1];
     ztmp = x[i][2];
     itype = type[i];
-    jlist = firstneigh[i];
-    jnum = numneigh[i];
+    jlist = pol_firstneigh[i];
+    jnum = pol_numneigh[i];
 
     for (jj = 0; jj < jnum; jj++) {
       j = jlist[jj];
       factor_coul = special_coul[sbmask(j)];
       j &= NEIGHMASK;
 
-      // only on core-drude pair, but not into the same pair
-      if (drudetype[type[j]] == NOPOL_TYPE || j == di)
-        continue;
-
-      // get dq of the core via the drude charge
-      if (drudetype[type[j]] == DRUDE_TYPE)
-        qj = q[j];
-      else {
-        dj = domain->closest_image(j, atom->map(drudeid[j]));
-        qj = -q[dj];
-      }
+      qj = drude_dq[j];
 
       delx = xtmp - x[j][0];
       dely = ytmp - x[j][1];
@@ -133,10 +127,16 @@ void PairThole::compute(int eflag, int vflag)
 
         r = sqrt(rsq);
         asr = ascreen[itype][jtype] * r;
-        exp_asr = exp(-asr);
         dcoul = qqrd2e * qi * qj *scale[itype][jtype] * rinv;
-        factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr)))) - factor_coul;
-        if(eflag) factor_e = 0.5*(2. - (exp_asr * (2. + asr))) - factor_coul;
+        if (!tholetablebits || asr*asr <= tholetable->innersq) {
+          exp_asr = exp(-asr);
+          factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr)))) - factor_coul;
+          if(eflag) factor_e = 0.5*(2. - (exp_asr * (2. + asr))) - factor_coul;
+        } else {
+          tholetable->lookup(asr*asr,damp_f,damp_e,eflag);
+          factor_f = 1.0 - damp_f - factor_coul;
+          if(eflag) factor_e = 1.0 - damp_e - factor_coul;
+        }
         fpair = factor_f * dcoul * r2inv;
 
         f[i][0] += delx*fpair;
@@ -160,6 +160,69 @@ void PairThole::compute(int eflag, int vflag)
   if (vflag_fdotr) virial_fdotr_compute();
 }
 
+/* ----------------------------------------------------------------------
+   extract from the neighbor list the pairs of polarizable atoms,
+   core or Drude, except the core-Drude pairs of a same atom
+   done at reneighboring, when drude_local has just been updated
+------------------------------------------------------------------------- */
+
+void PairThole::build_pol_list()
+{
+  int i,j,ii,jj,n,jnum,di;
+  int *jlist,*neighptr;
+
+  int *type = atom->type;
+  int *drudetype = fix_drude->drudetype;
+  int *drude_local = fix_drude->drude_local;
+
+  int inum = list->inum;
+  int *ilist = list->ilist;
+  int *numneigh = list->numneigh;
+  int **firstneigh = list->firstneigh;
+
+  // grow the per-atom arrays if necessary
+
+  if (atom->nmax > maxlocal) {
+    maxlocal = atom->nmax;
+    memory->destroy(pol_ilist);
+    memory->destroy(pol_numneigh);
+    memory->sfree(pol_firstneigh);
+    memory->create(pol_ilist,maxlocal,"thole:pol_ilist");
+    memory->create(pol_numneigh,maxlocal,"thole:pol_numneigh");
+    pol_firstneigh = (int **) memory->smalloc(maxlocal*sizeof(int *),
+                                              "thole:pol_firstneigh");
+  }
+
+  // the special bits of the neighbors are kept
+
+  pol_inum = 0;
+  ipage->reset();
+
+  for (ii = 0; ii < inum; ii++) {
+    i = ilist[ii];
+    if (drudetype[type[i]] == NOPOL_TYPE) continue;
+
+    n = 0;
+    neighptr = ipage->vget();
+    di = drude_local[i];
+    jlist = firstneigh[i];
+    jnum = numneigh[i];
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj] & NEIGHMASK;
+      if (drudetype[type[j]] == NOPOL_TYPE || j == di) continue;
+      neighptr[n++] = jlist[jj];
+    }
+
+    pol_ilist[pol_inum++] = i;
+    pol_firstneigh[i] = neighptr;
+    pol_numneigh[i] = n;
+    ipage->vgot(n);
+    if (ipage->status())
+      error->one(FLERR,"Neighbor list overflow, boost neigh_modify one");
+  }
+}
+
 /* ----------------------------------------------------------------------
    allocate all arrays
 ------------------------------------------------------------------------- */
@@ -244,6 +307,32 @@ void PairThole::coeff(int narg, char **arg)
 }
 
 
+/* ----------------------------------------------------------------------
+   pair_modify keyword for the damping table, others go to Pair
+------------------------------------------------------------------------- */
+
+void PairThole::modify_params(int narg, char **arg)
+{
+  if (narg == 0) error->all(FLERR,"Illegal pair_modify command");
+
+  char **rest = new char*[narg];
+  int nrest = 0;
+
+  int iarg = 0;
+  while (iarg < narg) {
+    if (strcmp(arg[iarg],"thole/table") == 0) {
+      if (iarg+2 > narg) error->all(FLERR,"Illegal pair_modify command");
+      tholetablebits = force->inumeric(FLERR,arg[iarg+1]);
+      if (tholetablebits < 0 || tholetablebits > (int) sizeof(int)*8)
+        error->all(FLERR,"Illegal pair_modify command");
+      iarg += 2;
+    } else rest[nrest++] = arg[iarg++];
+  }
+
+  if (nrest) Pair::modify_params(nrest,rest);
+  delete [] rest;
+}
+
 /* ----------------------------------------------------------------------
    init specific to this pair style
 ------------------------------------------------------------------------- */
@@ -259,6 +348,24 @@ void PairThole::init_style()
   fix_drude = (FixDrude *) modify->fix[ifix];
 
   neighbor->request(this,instance_me);
+
+  tholetable->init(tholetablebits);
+
+  // pages of the polarizable neighbor list
+  // create pages if first time or if neighbor pgsize/oneatom has changed
+
+  int create = 0;
+  if (ipage == NULL) create = 1;
+  if (pgsize != neighbor->pgsize) create = 1;
+  if (oneatom != neighbor->oneatom) create = 1;
+
+  if (create) {
+    delete [] ipage;
+    pgsize = neighbor->pgsize;
+    oneatom = neighbor->oneatom;
+    ipage = new MyPage<int>[1];
+    ipage->init(oneatom,pgsize,PGDELTA);
+  }
 }
 
 /* ----------------------------------------------------------------------
@@ -338,6 +445,7 @@ void PairThole::write_restart_settings(FILE *fp)
   fwrite(&cut_global,sizeof(double),1,fp);
   fwrite(&offset_flag,sizeof(int),1,fp);
   fwrite(&mix_flag,sizeof(int),1,fp);
+  fwrite(&tholetablebits,sizeof(int),1,fp);
 }
 
 /* ----------------------------------------------------------------------
@@ -351,11 +459,13 @@ void PairThole::read_restart_settings(FILE *fp)
     fread(&cut_global,sizeof(double),1,fp);
     fread(&offset_flag,sizeof(int),1,fp);
     fread(&mix_flag,sizeof(int),1,fp);
+    fread(&tholetablebits,sizeof(int),1,fp);
   }
   MPI_Bcast(&thole_global,1,MPI_DOUBLE,0,world);
   MPI_Bcast(&cut_global,1,MPI_DOUBLE,0,world);
   MPI_Bcast(&offset_flag,1,MPI_INT,0,world);
   MPI_Bcast(&mix_flag,1,MPI_INT,0,world);
+  MPI_Bcast(&tholetablebits,1,MPI_INT,0,world);
 }
 
 /* ---------------------------------------------------------------------- */
@@ -365,31 +475,21 @@ double PairThole::single(int i, int j, int itype, int jtype,
                          double &fforce)
 {
   double r2inv,rinv,r,phicoul;
-  double qi,qj,factor_f,factor_e,dcoul,asr,exp_asr;
-  int di, dj;
+  double qi,qj,factor_f,factor_e,dcoul,asr,exp_asr,damp_f,damp_e;
 
   int *drudetype = fix_drude->drudetype;
-  tagint *drudeid = fix_drude->drudeid;
+  int *drude_local = fix_drude->drude_local;
+  double *drude_dq = fix_drude->drude_dq;
   int *type = atom->type;
 
   // only on core-drude pair, but not on the same pair
   if (drudetype[type[i]] == NOPOL_TYPE || drudetype[type[j]] == NOPOL_TYPE ||
-      j == i)
+      j == drude_local[i])
     return 0.0;
 
   // get dq of the core via the drude charge
-  if (drudetype[type[i]] == DRUDE_TYPE)
-    qi = atom->q[i];
-  else {
-    di = domain->closest_image(i, atom->map(drudeid[i]));
-    qi = -atom->q[di];
-  }
-  if (drudetype[type[j]] == DRUDE_TYPE)
-    qj = atom->q[j];
-  else {
-    dj = domain->closest_image(j, atom->map(drudeid[j]));
-    qj = -atom->q[dj];
-  }
+  qi = drude_dq[i];
+  qj = drude_dq[j];
 
   r2inv = 1.0/rsq;
   fforce = phicoul = 0.0;
@@ -397,17 +497,37 @@ double PairThole::single(int i, int j, int itype, int jtype,
     rinv = sqrt(r2inv);
     r = sqrt(rsq);
     asr = ascreen[itype][jtype] * r;
-    exp_asr = exp(-asr);
     dcoul = force->qqrd2e * qi * qj * scale[itype][jtype] * rinv;
-    factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr)))) - factor_coul;
+    if (!tholetablebits || asr*asr <= tholetable->innersq) {
+      exp_asr = exp(-asr);
+      factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr)))) - factor_coul;
+      factor_e = 0.5*(2. - (exp_asr * (2. + asr))) - factor_coul;
+    } else {
+      tholetable->lookup(asr*asr,damp_f,damp_e,1);
+      factor_f = 1.0 - damp_f - factor_coul;
+      factor_e = 1.0 - damp_e - factor_coul;
+    }
     fforce = factor_f * dcoul * r2inv;
-    factor_e = 0.5*(2. - (exp_asr * (2. + asr))) - factor_coul;
     phicoul = factor_e * dcoul;
   }
 
   return phicoul;
 }
 
+/* ----------------------------------------------------------------------
+   memory usage of the polarizable neighbor list
+------------------------------------------------------------------------- */
+
+double PairThole::memory_usage()
+{
+  double bytes = Pair::memory_usage();
+  bytes += 2*maxlocal * sizeof(int);
+  bytes += maxlocal * sizeof(int *);
+  if (ipage) bytes += ipage->size();
+  bytes += tholetable->memory_usage();
+  return bytes;
+}
+
 /* ---------------------------------------------------------------------- */
 
 void *PairThole::extract(const char *str, int &dim)
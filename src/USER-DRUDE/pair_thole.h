@@ -22,6 +22,7 @@ PairStyle(thole,PairThole)
 
 #include "pair.h"
 #include "fix_drude.h"
+#include "my_page.h"
 
 namespace LAMMPS_NS {
 
@@ -32,6 +33,7 @@ class PairThole : public Pair {
   virtual void compute(int, int);
   virtual void settings(int, char **);
   void coeff(int, char **);
+  void modify_params(int, char **);
   void init_style();
   double init_one(int, int);
   void write_restart(FILE *);
@@ -40,6 +42,7 @@ class PairThole : public Pair {
   virtual void read_restart_settings(FILE *);
   virtual double single(int, int, int, int, double, double, double, double &);
   void *extract(const char *, int &);
+  double memory_usage();
 
  protected:
   double thole_global;
@@ -47,8 +50,21 @@ class PairThole : public Pair {
   double **cut,**scale;
   double **polar,**thole,**ascreen;
   FixDrude * fix_drude;
+  int tholetablebits;       // 2^N entries in the damping table, 0 = none
+  class TholeTable *tholetable;
+
+  // neighbor list of the polarizable atoms, without the core-Drude pairs
+
+  int pol_inum;
+  int maxlocal;
+  int *pol_ilist;
+  int *pol_numneigh;
+  int **pol_firstneigh;
+  MyPage<int> *ipage;
+  int pgsize,oneatom;
 
   virtual void allocate();
+  void build_pol_list();
 };
 
 }
@@ -58,6 +74,17 @@ class PairThole : public Pair {
 
 /* ERROR/WARNING messages:
 
+E: Neighbor list overflow, boost neigh_modify one
+
+There are too many neighbors of a single atom.  Use the neigh_modify
+command to increase the max number of neighbors allowed for one atom.
+You may also want to boost the page size.
+
+E: Illegal pair_modify command
+
+Self-explanatory.  Check the input script syntax and compare to the
+documentation for the command.
+
 E: Illegal ... command
 
 Self-explanatory.  Check the input script syntax and compare to the
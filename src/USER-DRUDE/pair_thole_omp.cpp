@@ -0,0 +1,175 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pair_thole_omp.h"
+#include "atom.h"
+#include "comm.h"
+#include "force.h"
+#include "neighbor.h"
+#include "neigh_list.h"
+#include "error.h"
+#include "thole_table.h"
+#include "suffix.h"
+
+using namespace LAMMPS_NS;
+
+/* ---------------------------------------------------------------------- */
+
+PairTholeOMP::PairTholeOMP(LAMMPS *lmp) :
+    PairThole(lmp), ThrOMP(lmp, THR_PAIR)
+{
+    suffix_flag |= Suffix::OMP;
+    respa_enable = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void PairTholeOMP::compute(int eflag, int vflag)
+{
+  if (eflag || vflag) {
+    ev_setup(eflag,vflag);
+  } else evflag = vflag_fdotr = 0;
+
+  const int nall = atom->nlocal + atom->nghost;
+  const int nthreads = comm->nthreads;
+
+  if (neighbor->ago == 0) build_pol_list();
+  const int inum = pol_inum;
+
+#if defined(_OPENMP)
+#pragma omp parallel default(none) shared(eflag,vflag)
+#endif
+  {
+    int ifrom, ito, tid;
+
+    loop_setup_thr(ifrom, ito, tid, inum, nthreads);
+    ThrData *thr = fix->get_thr(tid);
+    thr->timer(Timer::START);
+    ev_setup_thr(eflag, vflag, nall, eatom, vatom, thr);
+
+    if (evflag) {
+      if (eflag) {
+        if (force->newton_pair) eval<1,1,1>(ifrom, ito, thr);
+        else eval<1,1,0>(ifrom, ito, thr);
+      } else {
+        if (force->newton_pair) eval<1,0,1>(ifrom, ito, thr);
+        else eval<1,0,0>(ifrom, ito, thr);
+      }
+    } else {
+      if (force->newton_pair) eval<0,0,1>(ifrom, ito, thr);
+      else eval<0,0,0>(ifrom, ito, thr);
+    }
+    thr->timer(Timer::PAIR);
+    reduce_thr(this, eflag, vflag, thr);
+  } // end of omp parallel region
+}
+
+template <int EVFLAG, int EFLAG, int NEWTON_PAIR>
+void PairTholeOMP::eval(int iifrom, int iito, ThrData * const thr)
+{
+  const dbl3_t * _noalias const x = (dbl3_t *) atom->x[0];
+  dbl3_t * _noalias const f = (dbl3_t *) thr->get_f()[0];
+  const int * _noalias const type = atom->type;
+  const double * _noalias const special_coul = force->special_coul;
+  const int * _noalias const ilist = pol_ilist;
+  const int * _noalias const numneigh = pol_numneigh;
+  const int * const * const firstneigh = pol_firstneigh;
+  const double * _noalias const drude_dq = fix_drude->drude_dq;
+
+  double xtmp,ytmp,ztmp,delx,dely,delz,fxtmp,fytmp,fztmp;
+
+  const int nlocal = atom->nlocal;
+
+  int j,jj,jnum,jtype;
+  double ecoul,fpair;
+  double r,rsq,r2inv,rinv,factor_coul;
+  double factor_f,factor_e;
+  double qi,qj,dcoul,asr,exp_asr,damp_f,damp_e;
+  const double qqrd2e = force->qqrd2e;
+
+  ecoul = 0.0;
+
+  // loop over polarizable neighbors of my polarizable atoms
+  for (int ii = iifrom; ii < iito; ii++) {
+    const int i = ilist[ii];
+    const int itype = type[i];
+
+    // dq of the core is minus the drude charge
+    qi = drude_dq[i];
+
+    const int * _noalias const jlist = firstneigh[i];
+    const double * _noalias const cutsqi = cutsq[itype];
+    const double * _noalias const ascreeni = ascreen[itype];
+    const double * _noalias const scalei = scale[itype];
+
+    xtmp = x[i].x;
+    ytmp = x[i].y;
+    ztmp = x[i].z;
+    jnum = numneigh[i];
+    fxtmp=fytmp=fztmp=0.;
+
+    for (jj = 0; jj < jnum; jj++) {
+      j = jlist[jj];
+      factor_coul = special_coul[sbmask(j)];
+      j &= NEIGHMASK;
+      jtype = type[j];
+
+      qj = drude_dq[j];
+
+      delx = xtmp - x[j].x;
+      dely = ytmp - x[j].y;
+      delz = ztmp - x[j].z;
+      rsq = delx*delx + dely*dely + delz*delz;
+
+      if (rsq < cutsqi[jtype]) {
+        r2inv = 1.0/rsq;
+        rinv = sqrt(r2inv);
+
+        r = sqrt(rsq);
+        asr = ascreeni[jtype] * r;
+        dcoul = qqrd2e * qi * qj * scalei[jtype] * rinv;
+        if (!tholetablebits || asr*asr <= tholetable->innersq) {
+          exp_asr = exp(-asr);
+          factor_f = 0.5*(2. + (exp_asr * (-2. - asr * (2. + asr)))) - factor_coul;
+          if (EFLAG) factor_e = 0.5*(2. - (exp_asr * (2. + asr))) - factor_coul;
+        } else {
+          tholetable->lookup(asr*asr,damp_f,damp_e,EFLAG);
+          factor_f = 1.0 - damp_f - factor_coul;
+          if (EFLAG) factor_e = 1.0 - damp_e - factor_coul;
+        }
+        fpair = factor_f * dcoul * r2inv;
+
+        fxtmp += delx*fpair;
+        fytmp += dely*fpair;
+        fztmp += delz*fpair;
+        if (NEWTON_PAIR || j < nlocal) {
+          f[j].x -= delx*fpair;
+          f[j].y -= dely*fpair;
+          f[j].z -= delz*fpair;
+        }
+
+        if (EFLAG) ecoul = factor_e * dcoul;
+
+        if (EVFLAG) ev_tally_thr(this,i,j,nlocal,NEWTON_PAIR,
+                                 0.0,ecoul,fpair,delx,dely,delz,thr);
+      }
+    }
+    f[i].x += fxtmp;
+    f[i].y += fytmp;
+    f[i].z += fztmp;
+  }
+}
@@ -0,0 +1,83 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Counter-based Philox4x32-10 random number generator
+   Salmon, Moraes, Dror, Shaw, SC11 (2011).
+   The numbers only depend on the seed and the counter, e.g. the
+   timestep and the atom tag, so there is no state to share between
+   threads and the sequence does not depend on the decomposition.
+------------------------------------------------------------------------- */
+
+#ifndef LMP_RANDOM_PHILOX_H
+#define LMP_RANDOM_PHILOX_H
+
+#include <math.h>
+#include <stdint.h>
+#include "lmptype.h"
+
+namespace LAMMPS_NS {
+
+class RanPhilox {
+ public:
+  RanPhilox(int seed) : key0((uint32_t) seed), key1(0x9E3779B9u ^ (uint32_t) seed) {}
+
+  // 4 uniform numbers in (0,1) for the counter (step, tag, stream)
+
+  void uniform(bigint step, tagint tag, int stream, double *u) const
+  {
+    uint32_t c[4], k[2];
+    c[0] = (uint32_t) step;
+    c[1] = (uint32_t) (((uint64_t) step) >> 32) ^ ((uint32_t) stream << 16);
+    c[2] = (uint32_t) tag;
+    c[3] = (uint32_t) (((uint64_t) tag) >> 32);
+    k[0] = key0;
+    k[1] = key1;
+    for (int r = 0; r < 10; r++) {
+      if (r) {
+        k[0] += 0x9E3779B9u;
+        k[1] += 0xBB67AE85u;
+      }
+      uint64_t p0 = (uint64_t) 0xD2511F53u * c[0];
+      uint64_t p1 = (uint64_t) 0xCD9E8D57u * c[2];
+      uint32_t hi0 = (uint32_t) (p0 >> 32), lo0 = (uint32_t) p0;
+      uint32_t hi1 = (uint32_t) (p1 >> 32), lo1 = (uint32_t) p1;
+      c[0] = hi1 ^ c[1] ^ k[0];
+      c[1] = lo1;
+      c[2] = hi0 ^ c[3] ^ k[1];
+      c[3] = lo0;
+    }
+    for (int i = 0; i < 4; i++) u[i] = (c[i] + 0.5) * 2.3283064365386963e-10;
+  }
+
+  // 4 Gaussian numbers with zero mean and unit variance (Box-Muller)
+
+  void gaussian(bigint step, tagint tag, int stream, double *g) const
+  {
+    double u[4];
+    uniform(step, tag, stream, u);
+    for (int i = 0; i < 4; i += 2) {
+      double r = sqrt(-2.0*log(u[i]));
+      double theta = 6.283185307179586 * u[i+1];
+      g[i] = r * cos(theta);
+      g[i+1] = r * sin(theta);
+    }
+  }
+
+ private:
+  uint32_t key0, key1;
+};
+
+}
+
+#endif
@@ -0,0 +1,235 @@
+/* ----------------------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+#include <math.h>
+#include <stdio.h>
+#include <float.h>
+#include <limits.h>
+#include "thole_table.h"
+#include "comm.h"
+#include "memory.h"
+#include "error.h"
+
+using namespace LAMMPS_NS;
+
+// range of x = ascreen*r covered by the table
+// below XINNER the damping is computed directly,
+// beyond XOUTER it is below 1.0e-11 and set to zero
+
+#define XINNER 1.0
+#define XOUTER 32.0
+
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#define MAX(a,b) ((a) > (b) ? (a) : (b))
+
+/* ----------------------------------------------------------------------
+   exact damping of the force and energy at x
+------------------------------------------------------------------------- */
+
+static inline void damping(double x, double &damp_f, double &damp_e)
+{
+  double exp_x = exp(-x);
+  damp_f = exp_x * (1.0 + x + 0.5*x*x);
+  damp_e = exp_x * (1.0 + 0.5*x);
+}
+
+/* ---------------------------------------------------------------------- */
+
+TholeTable::TholeTable(LAMMPS *lmp) : Pointers(lmp)
+{
+  ntablebits = 0;
+  ntable = 0;
+  innersq = outersq = 0.0;
+  xtable = dxtable = ftable = dftable = etable = detable = NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+
+TholeTable::~TholeTable()
+{
+  deallocate();
+}
+
+/* ----------------------------------------------------------------------
+   build the table with 2^nbits entries, none if nbits = 0
+------------------------------------------------------------------------- */
+
+void TholeTable::init(int nbits)
+{
+  deallocate();
+  ntablebits = nbits;
+  if (ntablebits == 0) return;
+
+  int i,masklo,maskhi;
+  init_bitmap(XINNER,XOUTER,ntablebits,masklo,maskhi);
+  ntable = 1;
+  for (i = 0; i < ntablebits; i++) ntable *= 2;
+  allocate();
+
+  innersq = XINNER*XINNER;
+  outersq = XOUTER*XOUTER;
+
+  // the table entries wrap around from the largest x^2 with masklo
+  // to the smallest one with maskhi
+
+  union_int_float_t xsq_lookup,minxsq_lookup;
+  minxsq_lookup.i = 0 << nshiftbits;
+  minxsq_lookup.i |= maskhi;
+
+  for (i = 0; i < ntable; i++) {
+    xsq_lookup.i = i << nshiftbits;
+    xsq_lookup.i |= masklo;
+    if (xsq_lookup.f < innersq) {
+      xsq_lookup.i = i << nshiftbits;
+      xsq_lookup.i |= maskhi;
+    }
+    xtable[i] = xsq_lookup.f;
+    damping(sqrtf(xsq_lookup.f),ftable[i],etable[i]);
+    minxsq_lookup.f = MIN(minxsq_lookup.f,xsq_lookup.f);
+  }
+
+  innersq = minxsq_lookup.f;
+
+  int ntablem1 = ntable - 1;
+  for (i = 0; i < ntablem1; i++) {
+    dxtable[i] = 1.0/(xtable[i+1] - xtable[i]);
+    dftable[i] = ftable[i+1] - ftable[i];
+    detable[i] = etable[i+1] - etable[i];
+  }
+  dxtable[ntablem1] = 1.0/(xtable[0] - xtable[ntablem1]);
+  dftable[ntablem1] = ftable[0] - ftable[ntablem1];
+  detable[ntablem1] = etable[0] - etable[ntablem1];
+
+  // the bin holding the largest x^2 interpolates up to outersq
+
+  int itablemin = minxsq_lookup.i & mask;
+  itablemin >>= nshiftbits;
+  int itablemax = itablemin - 1;
+  if (itablemin == 0) itablemax = ntablem1;
+  xsq_lookup.i = itablemax << nshiftbits;
+  xsq_lookup.i |= maskhi;
+
+  if (xsq_lookup.f < outersq) {
+    double damp_f,damp_e;
+    damping(XOUTER,damp_f,damp_e);
+    dxtable[itablemax] = 1.0/(outersq - xtable[itablemax]);
+    dftable[itablemax] = damp_f - ftable[itablemax];
+    detable[itablemax] = damp_e - etable[itablemax];
+  }
+
+  // largest interpolation error, sampled between the table entries
+
+  double x,xsq,damp_f,damp_e,table_f,table_e;
+  double errmax_f = 0.0, errmax_e = 0.0;
+  int nsample = 8*ntable;
+  double dxsq = (outersq - innersq) / nsample;
+
+  for (i = 0; i < nsample; i++) {
+    xsq = innersq + (i+0.5)*dxsq;
+    x = sqrt(xsq);
+    damping(x,damp_f,damp_e);
+    lookup(xsq,table_f,table_e,1);
+    errmax_f = MAX(errmax_f,fabs(table_f-damp_f));
+    errmax_e = MAX(errmax_e,fabs(table_e-damp_e));
+  }
+
+  if (comm->me == 0) {
+    if (screen)
+      fprintf(screen,"  Thole damping table: %d entries, "
+              "max error %g (force) %g (energy)\n",ntable,errmax_f,errmax_e);
+    if (logfile)
+      fprintf(logfile,"  Thole damping table: %d entries, "
+              "max error %g (force) %g (energy)\n",ntable,errmax_f,errmax_e);
+  }
+}
+
+/* ----------------------------------------------------------------------
+   set mask and shift to index the table with the float bits of x^2
+   in [inner^2,outer^2], as for the Coulomb tables
+------------------------------------------------------------------------- */
+
+void TholeTable::init_bitmap(double inner, double outer, int nbits,
+                             int &masklo, int &maskhi)
+{
+  if (sizeof(int) != sizeof(float))
+    error->all(FLERR,"Bitmapped lookup tables require int/float be same size");
+
+  int nlowermin = 1;
+  while (!((pow(2.0,(double) nlowermin) <= inner*inner) &&
+           (pow(2.0,(double) nlowermin+1.0) > inner*inner))) {
+    if (pow(2.0,(double) nlowermin) <= inner*inner) nlowermin++;
+    else nlowermin--;
+  }
+
+  int nexpbits = 0;
+  double required_range = outer*outer / pow(2.0,(double) nlowermin);
+  double available_range = 2.0;
+
+  while (available_range < required_range) {
+    nexpbits++;
+    available_range = pow(2.0,pow(2.0,(double) nexpbits));
+  }
+
+  int nmantbits = nbits - nexpbits;
+
+  if (nexpbits > (int) (sizeof(float)*CHAR_BIT) - FLT_MANT_DIG)
+    error->all(FLERR,"Too many exponent bits for lookup table");
+  if (nmantbits+1 > FLT_MANT_DIG)
+    error->all(FLERR,"Too many mantissa bits for lookup table");
+  if (nmantbits < 3) error->all(FLERR,"Too few bits for lookup table");
+
+  nshiftbits = FLT_MANT_DIG - (nmantbits+1);
+
+  mask = 1;
+  for (int j = 0; j < nbits+nshiftbits; j++) mask *= 2;
+  mask -= 1;
+
+  union_int_float_t xsq_lookup;
+  xsq_lookup.f = outer*outer;
+  maskhi = xsq_lookup.i & ~(mask);
+  xsq_lookup.f = inner*inner;
+  masklo = xsq_lookup.i & ~(mask);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void TholeTable::allocate()
+{
+  memory->create(xtable,ntable,"thole:xtable");
+  memory->create(dxtable,ntable,"thole:dxtable");
+  memory->create(ftable,ntable,"thole:ftable");
+  memory->create(dftable,ntable,"thole:dftable");
+  memory->create(etable,ntable,"thole:etable");
+  memory->create(detable,ntable,"thole:detable");
+}
+
+/* ---------------------------------------------------------------------- */
+
+void TholeTable::deallocate()
+{
+  memory->destroy(xtable);
+  memory->destroy(dxtable);
+  memory->destroy(ftable);
+  memory->destroy(dftable);
+  memory->destroy(etable);
+  memory->destroy(detable);
+  xtable = dxtable = ftable = dftable = etable = detable = NULL;
+  ntable = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+double TholeTable::memory_usage()
+{
+  return 6.0*ntable*sizeof(double);
+}
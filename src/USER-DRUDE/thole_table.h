@@ -0,0 +1,94 @@
+/* -*- c++ -*- ----------------------------------------------------------
+   LAMMPS - Large-scale Atomic/Molecular Massively Parallel Simulator
+   http://lammps.sandia.gov, Sandia National Laboratories
+   Steve Plimpton, sjplimp@sandia.gov
+
+   Copyright (2003) Sandia Corporation.  Under the terms of Contract
+   DE-AC04-94AL85000 with Sandia Corporation, the U.S. Government retains
+   certain rights in this software.  This software is distributed under
+   the GNU General Public License.
+
+   See the README file in the top-level LAMMPS directory.
+------------------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------------
+   Lookup table of the Thole damping functions
+     force:  exp(-x) (1 + x + x^2/2)
+     energy: exp(-x) (1 + x/2)
+   with x = ascreen*r, so one table serves all pairs of types.
+   The table is indexed by the bits of x^2 as a float, like the
+   Coulomb tables of pair_modify table.
+------------------------------------------------------------------------- */
+
+#ifndef LMP_THOLE_TABLE_H
+#define LMP_THOLE_TABLE_H
+
+#include "pointers.h"
+#include "pair.h"
+
+namespace LAMMPS_NS {
+
+class TholeTable : protected Pointers {
+ public:
+  TholeTable(class LAMMPS *);
+  ~TholeTable();
+  void init(int);
+  double memory_usage();
+
+  int ntablebits;           // 0 if the table is not used
+  double innersq;           // x^2 below which the damping is computed
+  double outersq;           // x^2 beyond which the damping is zero
+
+  // damping of the force and (if eflag) energy at x^2 = xsq > innersq
+
+  inline void lookup(double xsq, double &damp_f, double &damp_e,
+                     int eflag) const {
+    if (xsq >= outersq) {
+      damp_f = damp_e = 0.0;
+      return;
+    }
+    union_int_float_t xsq_lookup;
+    xsq_lookup.f = xsq;
+    int itable = xsq_lookup.i & mask;
+    itable >>= nshiftbits;
+    double fraction = (xsq_lookup.f - xtable[itable]) * dxtable[itable];
+    damp_f = ftable[itable] + fraction*dftable[itable];
+    if (eflag) damp_e = etable[itable] + fraction*detable[itable];
+  }
+
+ private:
+  int ntable,mask,nshiftbits;
+  double *xtable,*dxtable,*ftable,*dftable,*etable,*detable;
+
+  void allocate();
+  void deallocate();
+  void init_bitmap(double, double, int, int &, int &);
+};
+
+}
+
+#endif
+
+/* ERROR/WARNING messages:
+
+E: Bitmapped lookup tables require int/float be same size
+
+Cannot use pair_modify thole/table with a machine that has this
+characteristic.
+
+E: Too many exponent bits for lookup table
+
+Table size specified via pair_modify command does not work with your
+machine's floating point representation.
+
+E: Too many mantissa bits for lookup table
+
+Table size specified via pair_modify command does not work with your
+machine's floating point representation.
+
+E: Too few bits for lookup table
+
+Table size specified via pair_modify command does not work with your
+machine's floating point representation.
+
+*/